@@ -0,0 +1,230 @@
+#include <sdkconfig.h>
+#include <cct_mix.h>
+#include <helpers.hpp>
+#include <cx_math.hpp>
+#include "kelvin_ref.hpp"
+
+#ifndef CONFIG_LED_DRIVER_WHITE_CCT
+#define CONFIG_LED_DRIVER_WHITE_CCT 6500
+#endif
+#ifndef CONFIG_LED_DRIVER_WARMWHITE_CCT
+#define CONFIG_LED_DRIVER_WARMWHITE_CCT 2700
+#endif
+
+static_assert(CONFIG_LED_DRIVER_WHITE_CCT > CONFIG_LED_DRIVER_WARMWHITE_CCT, "Cool white must be the higher CCT");
+
+/* Mired -> channel mix table, generated at compile time from the two white LEDs' CCTs */
+namespace {
+
+constexpr int CCT_MIX_SIZE = LED_CCT_MIRED_MAX - LED_CCT_MIRED_MIN + 1;
+
+struct cct_xy_t {
+    double x, y;
+};
+
+/* CIE 1931 xy of the Planckian locus, cubic spline fit by Kim et al. (1667K - 25000K) */
+constexpr cct_xy_t planck_xy(double kelvin) {
+    double t = cx::clamp(kelvin, 1667, 25000);
+    double i = 1e3 / t, i2 = i * i, i3 = i2 * i;
+
+    double x = (t <= 4000) ? (-0.2661239 * i3 - 0.2343589 * i2 + 0.8776956 * i + 0.179910)
+                           : (-3.0258469 * i3 + 2.1070379 * i2 + 0.2226347 * i + 0.240390);
+    double x2 = x * x, x3 = x2 * x;
+
+    double y = (t <= 2222) ? (-1.1063814 * x3 - 1.34811020 * x2 + 2.18555832 * x - 0.20219683)
+             : (t <= 4000) ? (-0.9549476 * x3 - 1.37418593 * x2 + 2.09137015 * x - 0.16748867)
+                           : ( 3.0817580 * x3 - 5.87338670 * x2 + 3.75112997 * x - 0.37001483);
+    return { x, y };
+}
+
+constexpr cct_xy_t cool_xy = planck_xy(CONFIG_LED_DRIVER_WHITE_CCT);
+constexpr cct_xy_t warm_xy = planck_xy(CONFIG_LED_DRIVER_WARMWHITE_CCT);
+
+/* Position of a color along warm -> cool white in xy, 0 at the warm LED and 1 at the cool one */
+constexpr double white_position(cct_xy_t want) {
+    double dx = cool_xy.x - warm_xy.x, dy = cool_xy.y - warm_xy.y;
+    return cx::clamp(((want.x - warm_xy.x) * dx + (want.y - warm_xy.y) * dy) / (dx * dx + dy * dy), 0, 1);
+}
+
+/* Share of cool white light that puts the W/WW mix at position s. Mixing adds XYZ, so the xy
+ * position is weighted by Y / y of each LED, not by Y alone */
+constexpr double cool_share(double s) {
+    return s * cool_xy.y / (s * cool_xy.y + (1 - s) * warm_xy.y);
+}
+
+/* RGB that pulls the end LED (edge) toward the target color: the target's tint scaled up until it covers the
+ * LED's own, minus the LED. Zero at the edge itself and grows the further out the target is */
+constexpr cx::rgb_ref_t rgb_assist(double target_k, double edge_k) {
+    cx::rgb_ref_t t = cx::kelvin_to_rgb(target_k / 100);
+    cx::rgb_ref_t e = cx::kelvin_to_rgb(edge_k / 100);
+
+    double k = 1.0;
+    if (t.r > 0) k = (e.r / t.r > k) ? e.r / t.r : k;
+    if (t.g > 0) k = (e.g / t.g > k) ? e.g / t.g : k;
+    if (t.b > 0) k = (e.b / t.b > k) ? e.b / t.b : k;
+
+    return { cx::clamp(k * t.r - e.r, 0, 255 * k) / (255 * k),
+             cx::clamp(k * t.g - e.g, 0, 255 * k) / (255 * k),
+             cx::clamp(k * t.b - e.b, 0, 255 * k) / (255 * k) };
+}
+
+constexpr RGB_CCT_q15_t make_cct_mix(double mireds) {
+    double kelvin = 1e6 / mireds;
+    double a = cool_share(white_position(planck_xy(kelvin)));
+
+    RGB_CCT_q15_t mix = {};
+    mix.white     = cx::to_u16(a * Q15_ONE, Q15_ONE);
+    mix.warmwhite = Q15_ONE - mix.white;
+
+#if CONFIG_LED_DRIVER_CCT_RGB_ASSIST
+    if (kelvin > CONFIG_LED_DRIVER_WHITE_CCT || kelvin < CONFIG_LED_DRIVER_WARMWHITE_CCT) {
+        double edge = (kelvin > CONFIG_LED_DRIVER_WHITE_CCT) ? CONFIG_LED_DRIVER_WHITE_CCT : CONFIG_LED_DRIVER_WARMWHITE_CCT;
+        cx::rgb_ref_t rgb = rgb_assist(kelvin, edge);
+
+        mix.red   = cx::to_u16(rgb.r * Q15_ONE, Q15_ONE);
+        mix.green = cx::to_u16(rgb.g * Q15_ONE, Q15_ONE);
+        mix.blue  = cx::to_u16(rgb.b * Q15_ONE, Q15_ONE);
+    }
+#endif
+    return mix;
+}
+
+struct cct_mix_lut_t {
+    RGB_CCT_q15_t v[CCT_MIX_SIZE];
+};
+
+constexpr cct_mix_lut_t make_cct_mix_lut() {
+    cct_mix_lut_t lut = {};
+    for (int i = 0; i < CCT_MIX_SIZE; i++) {
+        lut.v[i] = make_cct_mix(LED_CCT_MIRED_MIN + i);
+    }
+    return lut;
+}
+
+constexpr cct_mix_lut_t cct_mix_lut = make_cct_mix_lut();
+
+
+/* White extraction: linear RGB each W/WW blend stands in for, WHITE_MIX_STEPS + 1 points from warm to cool.
+ * Like the duty split above, both LEDs put out the same luminance at full, so each one is its chromaticity at Y = 1.
+ * Both are scaled by one factor so the largest channel of either matches the RGB dies at full */
+constexpr int WHITE_MIX_BITS  = 6;
+constexpr int WHITE_MIX_STEPS = 1 << WHITE_MIX_BITS;
+
+struct white_mix_t {
+    q15_t rgb[3]; // Linear RGB of the blend at a total white duty of 1, Q15
+    q15_t cool;   // Cool white share of the blend
+};
+
+struct white_mix_lut_t {
+    white_mix_t v[WHITE_MIX_STEPS + 1];
+};
+
+/* Linear sRGB of a chromaticity at luminance Y = 1 (XYZ = x / y, 1, z / y), not normalized */
+constexpr cx::rgb_ref_t white_linear_rgb(cct_xy_t w) {
+    double X = w.x / w.y, Z = (1 - w.x - w.y) / w.y;
+    const auto &M = cx::M_XYZ_RGB_F;
+    return { M[0][0] * X + M[0][1] + M[0][2] * Z, M[1][0] * X + M[1][1] + M[1][2] * Z, M[2][0] * X + M[2][1] + M[2][2] * Z };
+}
+
+constexpr white_mix_lut_t make_white_mix_lut() {
+    cx::rgb_ref_t cool = white_linear_rgb(cool_xy);
+    cx::rgb_ref_t warm = white_linear_rgb(warm_xy);
+
+    double peak = 0;
+    for (double c : { cool.r, cool.g, cool.b, warm.r, warm.g, warm.b }) {
+        peak = (c > peak) ? c : peak;
+    }
+
+    white_mix_lut_t lut = {};
+    for (int i = 0; i <= WHITE_MIX_STEPS; i++) {
+        double a = cool_share(static_cast<double>(i) / WHITE_MIX_STEPS);
+        double rgb[3] = { a * cool.r + (1 - a) * warm.r, a * cool.g + (1 - a) * warm.g, a * cool.b + (1 - a) * warm.b };
+
+        for (int c = 0; c < 3; c++) {
+            lut.v[i].rgb[c] = cx::to_u16(cx::clamp(rgb[c] / peak, 0, 1) * Q15_ONE, Q15_ONE);
+        }
+        lut.v[i].cool = cx::to_u16(a * Q15_ONE, Q15_ONE);
+    }
+    return lut;
+}
+
+constexpr white_mix_lut_t white_mix_lut = make_white_mix_lut();
+
+/* Projection onto warm -> cool in Matter xy units, as a dot product that lands directly on the table index with
+ * WHITE_POS_FRAC bits of fraction */
+constexpr int WHITE_POS_SHIFT = 16;
+constexpr int WHITE_POS_FRAC  = 8;
+
+constexpr int32_t to_matter_xy(double v) {
+    return static_cast<int32_t>(v * 65535 + 0.5);
+}
+
+constexpr int32_t white_pos_coeff(double d) {
+    double dx = cool_xy.x - warm_xy.x, dy = cool_xy.y - warm_xy.y;
+    double scale = WHITE_MIX_STEPS * static_cast<double>(1 << WHITE_POS_SHIFT) / (65535 * (dx * dx + dy * dy));
+    return static_cast<int32_t>(d * scale + ((d >= 0) ? 0.5 : -0.5));
+}
+
+constexpr int32_t WARM_X = to_matter_xy(warm_xy.x);
+constexpr int32_t WARM_Y = to_matter_xy(warm_xy.y);
+constexpr int32_t POS_DX = white_pos_coeff(cool_xy.x - warm_xy.x);
+constexpr int32_t POS_DY = white_pos_coeff(cool_xy.y - warm_xy.y);
+
+} // namespace
+
+void cct_mix_q15(uint16_t mireds, RGB_CCT_q15_t *mix) {
+    *mix = cct_mix_lut.v[clamp<uint16_t>(mireds, LED_CCT_MIRED_MIN, LED_CCT_MIRED_MAX) - LED_CCT_MIRED_MIN];
+}
+/* ----------------------------------------------------------------------------------------------- */
+
+void xy_white_mix_q15(uint16_t cx, uint16_t cy, RGB_CCT_q15_t *mix) {
+    RGB_q15_t lin;
+    xy_to_linear_lut(cx, cy, &lin);
+
+    // W/WW blend at the target's position on the line, interpolated between two table steps. The blend's RGB is
+    // affine in its cool share, lerping both with the same weight keeps them consistent
+    constexpr int SHIFT = WHITE_POS_SHIFT - WHITE_POS_FRAC;
+    int32_t pos = ((cx - WARM_X) * POS_DX + (cy - WARM_Y) * POS_DY + (1 << (SHIFT - 1))) >> SHIFT;
+    pos = clamp<int32_t>(pos, 0, WHITE_MIX_STEPS << WHITE_POS_FRAC);
+
+    int32_t idx  = std::min(pos >> WHITE_POS_FRAC, WHITE_MIX_STEPS - 1);
+    int32_t frac = pos - (idx << WHITE_POS_FRAC);
+    const white_mix_t &w0 = white_mix_lut.v[idx];
+    const white_mix_t &w1 = white_mix_lut.v[idx + 1];
+    auto lerp = [frac](int32_t a, int32_t b) -> uint32_t { return a + (((b - a) * frac) >> WHITE_POS_FRAC); };
+
+    uint32_t rgb[3] = { lerp(w0.rgb[0], w1.rgb[0]), lerp(w0.rgb[1], w1.rgb[1]), lerp(w0.rgb[2], w1.rgb[2]) };
+    uint32_t cool   = lerp(w0.cool, w1.cool);
+
+    // Amount of the blend (total white duty) that fits under every channel. Not capped at 1, the renormalization
+    // below brings it back; a cap would leave white on the RGB dies
+    uint32_t t[3] = { lin.red, lin.green, lin.blue };
+    uint32_t m = UINT32_MAX;
+    for (int c = 0; c < 3; c++) {
+        if (rgb[c]) {
+            m = std::min<uint32_t>(m, (t[c] << Q15_SHIFT) / rgb[c]);
+        }
+    }
+
+    // Residual chroma stays on RGB, the common white moves to W/WW
+    for (int c = 0; c < 3; c++) {
+        t[c] -= std::min<uint32_t>(t[c], ((uint64_t)m * rgb[c]) >> Q15_SHIFT);
+    }
+    uint32_t white     = ((uint64_t)m * cool) >> Q15_SHIFT;
+    uint32_t warmwhite = m - white;
+
+    // Renormalize to the brightest of the five so the fixture keeps its full output. Everything stays linear: a
+    // transfer step per channel would shift the W/WW blend and the residual against each other
+    uint32_t peak = std::max({t[0], t[1], t[2], white, warmwhite});
+    if (peak == 0) {
+        *mix = {};
+        return;
+    }
+
+    mix->red       = ((uint64_t)t[0] << Q15_SHIFT) / peak;
+    mix->green     = ((uint64_t)t[1] << Q15_SHIFT) / peak;
+    mix->blue      = ((uint64_t)t[2] << Q15_SHIFT) / peak;
+    mix->white     = ((uint64_t)white << Q15_SHIFT) / peak;
+    mix->warmwhite = ((uint64_t)warmwhite << Q15_SHIFT) / peak;
+}
+/* ----------------------------------------------------------------------------------------------- */
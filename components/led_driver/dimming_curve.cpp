@@ -0,0 +1,90 @@
+#include <dimming_curve.h>
+#include <led_driver.h>
+#include <led_dither.h>
+#include <cx_math.hpp>
+
+/* Level -> PWM count tables, generated at compile time for the configured duty resolution */
+namespace {
+
+struct dimming_lut_t {
+    uint16_t v[DIMMING_CURVE_LEVELS];
+};
+
+/* Relative luminance [0, 1] for a level [0, 1] */
+constexpr double curve_luminance(led_dimming_curve_t curve, double level) {
+    switch (curve) {
+    case DIMMING_CURVE_CIE: {
+        double L = level * 100.0;
+        return (L <= 8.0) ? (L / 903.3) : cx::pow((L + 16.0) / 116.0, 3.0);
+    }
+    case DIMMING_CURVE_GAMMA22:
+        return cx::pow(level, 2.2);
+    default:
+        return level;
+    }
+}
+
+constexpr dimming_lut_t make_dimming_lut(led_dimming_curve_t curve) {
+    dimming_lut_t lut = {};
+    for (int i = 1; i < DIMMING_CURVE_LEVELS; i++) {
+        double counts = curve_luminance(curve, static_cast<double>(i) / (DIMMING_CURVE_LEVELS - 1)) * LED_MAX_DUTY;
+
+        // Never round a non zero level down to off
+        lut.v[i] = (counts < 1.0) ? 1 : cx::to_u16(counts, LED_MAX_DUTY);
+    }
+    return lut;
+}
+
+constexpr dimming_lut_t dimming_luts[DIMMING_CURVE_MAX] = {
+    make_dimming_lut(DIMMING_CURVE_CIE),
+    make_dimming_lut(DIMMING_CURVE_GAMMA22),
+    make_dimming_lut(DIMMING_CURVE_LINEAR),
+};
+
+static_assert(dimming_luts[DIMMING_CURVE_LINEAR].v[DIMMING_CURVE_LEVELS - 1] == LED_MAX_DUTY, "Full level must be full duty");
+
+#if CONFIG_LED_DRIVER_DITHER
+struct dimming_fine_lut_t {
+    uint32_t v[DIMMING_CURVE_LEVELS];
+};
+
+constexpr dimming_fine_lut_t make_dimming_fine_lut(led_dimming_curve_t curve) {
+    dimming_fine_lut_t lut = {};
+    for (int i = 1; i < DIMMING_CURVE_LEVELS; i++) {
+        double fine = curve_luminance(curve, static_cast<double>(i) / (DIMMING_CURVE_LEVELS - 1)) * LED_MAX_DUTY * LED_DITHER_ONE;
+
+        // Same floor as the count tables, a non zero level is never below one whole count
+        lut.v[i] = (fine < LED_DITHER_ONE) ? LED_DITHER_ONE : static_cast<uint32_t>(fine + 0.5);
+    }
+    return lut;
+}
+
+constexpr dimming_fine_lut_t dimming_fine_luts[DIMMING_CURVE_MAX] = {
+    make_dimming_fine_lut(DIMMING_CURVE_CIE),
+    make_dimming_fine_lut(DIMMING_CURVE_GAMMA22),
+    make_dimming_fine_lut(DIMMING_CURVE_LINEAR),
+};
+
+static_assert(dimming_fine_luts[DIMMING_CURVE_LINEAR].v[DIMMING_CURVE_LEVELS - 1] == LED_MAX_DUTY * LED_DITHER_ONE,
+              "Full level must be full duty");
+#endif
+
+} // namespace
+
+const uint16_t *dimming_curve_table(led_dimming_curve_t curve) {
+    if (curve >= DIMMING_CURVE_MAX) {
+        curve = DIMMING_CURVE_CIE;
+    }
+    return dimming_luts[curve].v;
+}
+
+const uint32_t *dimming_curve_table_fine(led_dimming_curve_t curve) {
+#if CONFIG_LED_DRIVER_DITHER
+    if (curve >= DIMMING_CURVE_MAX) {
+        curve = DIMMING_CURVE_CIE;
+    }
+    return dimming_fine_luts[curve].v;
+#else
+    return nullptr;
+#endif
+}
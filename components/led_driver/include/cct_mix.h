@@ -0,0 +1,31 @@
+#ifndef CCTMIX_H
+#define CCTMIX_H
+
+#include <stdint.h>
+#include "./color_format.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Color temperature range covered by the mix table, the light's physical min/max mireds */
+#define LED_CCT_MIRED_MIN 153
+#define LED_CCT_MIRED_MAX 370
+
+/* Channel mix for a color temperature in mireds, one table read. The W/WW blend keeps the total white output
+ * constant and lands on the point of the two LEDs' chromaticity line closest to the Planckian locus. Outside the
+ * LEDs' own range the end LED stays fully on and RGB adds the missing tint (CONFIG_LED_DRIVER_CCT_RGB_ASSIST).
+ * Values outside the table range are clamped */
+void cct_mix_q15(uint16_t mireds, RGB_CCT_q15_t *mix);
+
+/* xy -> RGBWW. The white common to the target is moved onto the W/WW blend nearest to its xy, RGB only keeps
+ * the chromatic residual, and the result is normalized to its brightest channel like xy_to_linear_lut().
+ * All five are linear duty like the table above, the RGB ratio of the whole mix is the one xy_to_linear_lut()
+ * gives without extraction. Targets on the W/WW line come out on the whites alone */
+void xy_white_mix_q15(uint16_t cx, uint16_t cy, RGB_CCT_q15_t *mix);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CCTMIX_H
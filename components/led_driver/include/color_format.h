@@ -1,6 +1,7 @@
 #ifndef COLORFORMAT_H
 #define COLORFORMAT_H
 #include <stdint.h>
+#include <stddef.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -26,6 +27,23 @@ typedef struct : public RGB_color_t {
     float warmwhite;
 } RGB_CCT_Duty_t;
 
+/* Fixed point duty values, Q15 where Q15_ONE (32768) is a fully on channel.
+ * These are what the driver works with, the float types above are kept as the reference implementation. */
+typedef uint16_t q15_t;
+#define Q15_SHIFT 15
+#define Q15_ONE   (1 << Q15_SHIFT)
+
+typedef struct {
+    q15_t red;
+    q15_t green;
+    q15_t blue;
+} RGB_q15_t;
+
+typedef struct : public RGB_q15_t {
+    q15_t white;
+    q15_t warmwhite;
+} RGB_CCT_q15_t;
+
 //void RGB_to_RGBCCT(const RGB_color_t *rgb, RGB_CCT_Duty_t *rgbcct) {
 //    rgbcct->red = rgb->red;
 //    rgbcct->green = rgb->green;
@@ -46,6 +64,40 @@ void scale_RGB_duty(float scale, RGB_color_t *RGB);
 
 void colorTemperatureToRGB(uint32_t kelvin, RGB_color_t *RGB);
 
+/* Integer versions of the above. The xy conversion is normalized so the brightest channel is fully on,
+ * brightness is applied later when converting to PWM counts. */
+void xy_to_duty_q15(uint16_t cx, uint16_t cy, RGB_q15_t *RGB);
+
+/* Same as xy_to_duty_q15 but interpolated from a compile time grid */
+void xy_to_duty_lut(uint16_t cx, uint16_t cy, RGB_q15_t *RGB);
+
+/* The grid lookup and the gamma step of xy_to_duty_lut on their own. LED light output is linear in PWM duty, so
+ * the driver puts linear values on the channels: xy_to_linear_lut() is the one used per update, and the encoded
+ * results of hsv_to_duty_q15() and colorTemperatureToRGB_q15() go through srgb_to_linear_q15() first. That way a
+ * chromaticity gets the same channel ratios whichever path, or the white extraction, it comes through */
+void xy_to_linear_lut(uint16_t cx, uint16_t cy, RGB_q15_t *RGB);
+void linear_to_duty_q15(RGB_q15_t *RGB);
+void srgb_to_linear_q15(RGB_q15_t *RGB);
+
+/* Hue (16 bit, 65536 = 360 degrees) and saturation (Q15) at full value, integer only. sRGB encoded */
+void hsv_to_duty_q15(uint16_t hue, q15_t saturation, RGB_q15_t *RGB);
+
+void scale_RGB_duty_q15(q15_t scale, RGB_q15_t *RGB);
+
+void colorTemperatureToRGB_q15(uint32_t kelvin, RGB_q15_t *RGB);
+
+/* Pixels for the addressable strip, n per call. One array per channel in, so the loop stays branch free and
+ * vectorizes. Scales by level (Q15, at most Q15_ONE) and interleaves to 8 bit pixels in wire order, G R B or
+ * G R B W, rounded to the nearest step */
+typedef struct {
+    q15_t *red;
+    q15_t *green;
+    q15_t *blue;
+} RGB_q15_planes_t;
+
+void pack_grb_n(RGB_q15_planes_t in, q15_t level, uint8_t *out, size_t n);
+void pack_grbw_n(RGB_q15_planes_t in, const q15_t *white, q15_t level, uint8_t *out, size_t n);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,66 @@
+#ifndef CX_MATH_H
+#define CX_MATH_H
+
+#include <stdint.h>
+
+/* Minimal constexpr math used to generate the integer lookup tables at compile time.
+ * None of this is meant to run on the target, it only has to be accurate enough
+ * for the tables to match the float reference functions. */
+namespace cx {
+
+constexpr double LN2 = 0.693147180559945309417;
+
+constexpr double abs(double v) {
+    return (v < 0) ? -v : v;
+}
+
+/* e^x, reduced to e^r * 2^k with |r| <= ln2/2 */
+constexpr double exp(double x) {
+    int k = static_cast<int>(x / LN2 + ((x >= 0) ? 0.5 : -0.5));
+    double r = x - k * LN2;
+
+    double term = 1.0;
+    double sum  = 1.0;
+    for (int i = 1; i < 24; i++) {
+        term *= r / i;
+        sum  += term;
+    }
+
+    for (; k > 0; k--) sum *= 2.0;
+    for (; k < 0; k++) sum /= 2.0;
+    return sum;
+}
+
+/* ln(x) for x > 0, reduced to [1, 2) then ln(m) = 2*atanh((m-1)/(m+1)) */
+constexpr double log(double x) {
+    int e = 0;
+    while (x >= 2.0) { x /= 2.0; e++; }
+    while (x <  1.0) { x *= 2.0; e--; }
+
+    double s    = (x - 1.0) / (x + 1.0);
+    double s2   = s * s;
+    double term = s;
+    double sum  = 0.0;
+    for (int i = 1; i < 48; i += 2) {
+        sum  += term / i;
+        term *= s2;
+    }
+    return 2.0 * sum + e * LN2;
+}
+
+constexpr double pow(double base, double e) {
+    return (base <= 0.0) ? 0.0 : exp(e * log(base));
+}
+
+constexpr double clamp(double v, double mn, double mx) {
+    return (v < mn) ? mn : ((v > mx) ? mx : v);
+}
+
+/* Round to nearest and clamp into [0, mx] */
+constexpr uint16_t to_u16(double v, double mx) {
+    return static_cast<uint16_t>(clamp(v, 0.0, mx) + 0.5);
+}
+
+} // namespace cx
+
+#endif // CX_MATH_H
@@ -0,0 +1,31 @@
+#ifndef DIMMINGCURVE_H
+#define DIMMINGCURVE_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Number of entries in a dimming table, one per Matter level (0-254) */
+#define DIMMING_CURVE_LEVELS 255
+
+typedef enum {
+    DIMMING_CURVE_CIE,      // CIE 1931 L*, equal perceived steps per level
+    DIMMING_CURVE_GAMMA22,  // Plain 2.2 power law
+    DIMMING_CURVE_LINEAR,   // Level maps straight to duty
+    DIMMING_CURVE_MAX,
+} led_dimming_curve_t;
+
+/* Returns the level -> PWM count table for the curve, sized for LED_DUTY_RESOLUTION.
+ * Level 0 is always 0 counts, any other level is at least 1 count */
+const uint16_t *dimming_curve_table(led_dimming_curve_t curve);
+
+/* Same curve in counts << LED_DITHER_BITS, for CONFIG_LED_DRIVER_DITHER. NULL when dithering is off */
+const uint32_t *dimming_curve_table_fine(led_dimming_curve_t curve);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // DIMMINGCURVE_H
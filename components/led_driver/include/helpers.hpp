@@ -33,6 +33,7 @@ void set_all_values_in_array(T (&arr)[LEN], T val) {
 /** Default attribute values used during initialization */
 #define DEFAULT_POWER true
 #define DEFAULT_BRIGHTNESS 64
+#define DEFAULT_LEVEL (DEFAULT_BRIGHTNESS * MATTER_BRIGHTNESS / STANDARD_BRIGHTNESS) // DEFAULT_BRIGHTNESS (percent) as a Matter level
 
 
 /* Pin mappings from RGBWW to the respective GPIO values */
@@ -0,0 +1,43 @@
+#ifndef LEDDITHER_H
+#define LEDDITHER_H
+
+#include <stdint.h>
+#include <esp_err.h>
+#include <sdkconfig.h>
+#include <driver/ledc.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Duty below one PWM count. Duty is kept in counts << LED_DITHER_BITS and written with its fraction into the LEDC duty
+ * register, whose fractional bits the hardware dithers across periods so the average lands between two counts. Fades are
+ * stepped in those fine units by a timer interrupt, which only runs while some channel fades */
+#ifndef CONFIG_LED_DRIVER_DITHER_BITS
+#define CONFIG_LED_DRIVER_DITHER_BITS 3
+#endif
+#ifndef CONFIG_LED_DRIVER_DITHER_HZ
+#define CONFIG_LED_DRIVER_DITHER_HZ 5000
+#endif
+
+#define LED_DITHER_BITS CONFIG_LED_DRIVER_DITHER_BITS
+#define LED_DITHER_ONE  (1 << LED_DITHER_BITS)
+
+/* Creates the fade tick timer shared by all drivers, once. It only runs while a channel fades */
+esp_err_t led_dither_init(void);
+
+/* Moves a channel to duty (counts << LED_DITHER_BITS), linearly over fade_ms from wherever it is now.
+ * Takes over from LEDC's own fader, don't mix the two on one channel */
+esp_err_t led_dither_set(ledc_channel_t channel, uint32_t duty, uint32_t fade_ms);
+
+/* Ends a running fade where it is now, like ledc_fade_stop() */
+void led_dither_hold(ledc_channel_t channel);
+
+/* Stops touching the channel, for when it is turned off */
+void led_dither_release(ledc_channel_t channel);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LEDDITHER_H
@@ -6,6 +6,11 @@
 #include <stdint.h>
 #include <driver/ledc.h>
 #include "./color_format.h"
+#include "./dimming_curve.h"
+#include "./cct_mix.h"
+#include "./led_snapshot.h"
+#include "./led_dither.h"
+#include "./led_strip_out.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -19,19 +24,20 @@ typedef struct {
 
 typedef void *led_driver_handle_t;
 
-/* Channel mappings from RGBWW to the respective channels */
-#define CHANNEL_RED        LEDC_CHANNEL_0
-#define CHANNEL_GREEN      LEDC_CHANNEL_1
-#define CHANNEL_BLUE       LEDC_CHANNEL_2
-#define CHANNEL_WHITE      LEDC_CHANNEL_3
-#define CHANNEL_WARMWHITE  LEDC_CHANNEL_4
-/* ----------------------------------------------------- */
-
-
 /* Configures the channel and timer paramters */
 #define ESP32C6_MAX_CHANNELS 6
-#define LEDC_TIMER LEDC_TIMER_0
+#define ESP32C6_MAX_TIMERS 4
+#define LEDC_PWM_FREQ_HZ 5000
 #define LEDC_SPEED_MODE LEDC_LOW_SPEED_MODE
+#define LED_DUTY_RESOLUTION LEDC_TIMER_13_BIT
+#define LED_MAX_DUTY (1 << LED_DUTY_RESOLUTION)
+#define LED_FADE_SETTLE_US (200 * 1000) // How long after a fade the stack's late intermediate steps are still dropped
+#define LED_COLOR_LOOP_WHEEL_SIZE 256   // Hue wheel entries, the loop interpolates between neighbours
+
+#ifndef CONFIG_LED_DRIVER_SCENE_CACHE_SIZE
+#define CONFIG_LED_DRIVER_SCENE_CACHE_SIZE 8
+#endif
+#define LED_SCENE_CACHE_SIZE CONFIG_LED_DRIVER_SCENE_CACHE_SIZE // Entries per cache, scenes and recent colors each
 /* ------------------------------------------ */
 
 typedef struct {
@@ -39,25 +45,125 @@ typedef struct {
     ledc_channel_t channel;
 } led_channel_info_t;
 
+/* Pixels of the addressable strip (CONFIG_LED_DRIVER_STRIP) a fixture shows its color on */
+typedef struct {
+    uint16_t first;
+    uint16_t count; // 0 for LEDC fixtures
+} led_strip_span_t;
+
+/* One fixture. Colors without a gpio are not wired, channels and the timer are handed out by led_driver_assign_channels().
+ * A fixture with a strip span drives those pixels instead, its gpios are not used */
 typedef struct {
-    led_channel_info_t red       = {-1, CHANNEL_RED};
-    led_channel_info_t green     = {-1, CHANNEL_GREEN};
-    led_channel_info_t blue      = {-1, CHANNEL_BLUE};
-    led_channel_info_t white     = {-1, CHANNEL_WHITE};
-    led_channel_info_t warmwhite = {-1, CHANNEL_WARMWHITE};
+    led_channel_info_t red       = {-1, LEDC_CHANNEL_MAX};
+    led_channel_info_t green     = {-1, LEDC_CHANNEL_MAX};
+    led_channel_info_t blue      = {-1, LEDC_CHANNEL_MAX};
+    led_channel_info_t white     = {-1, LEDC_CHANNEL_MAX};
+    led_channel_info_t warmwhite = {-1, LEDC_CHANNEL_MAX};
+    ledc_timer_t timer = LEDC_TIMER_MAX;
+    led_strip_span_t strip = {0, 0};
+    int snapshot_slot = -1; // Fixture's index, keys its output snapshot (CONFIG_LED_SNAPSHOT). -1 keeps none
 } LED_GPIO_MAP;
 
+/* Gives every wired color of the map the next free LEDC channel, and the fixture its own timer. Strip fixtures take
+ * neither. ESP_ERR_NO_MEM once the chip runs out of either, nothing is assigned in that case */
+esp_err_t led_driver_assign_channels(LED_GPIO_MAP *map);
+
+typedef enum {
+    LED_COLOR_MODE_XY,
+    LED_COLOR_MODE_TEMPERATURE,
+    LED_COLOR_MODE_HS,
+} led_color_mode_t;
+
+/* Matter ColorLoop* attributes */
+typedef struct {
+    bool     active;    // ColorLoopActive
+    bool     up;        // ColorLoopDirection, 1 is increasing hue
+    uint16_t time_s;    // ColorLoopTime, seconds per full turn
+    uint16_t start_hue; // ColorLoopStartEnhancedHue
+} led_color_loop_t;
+
+/* Desired output state. Setters only stage into this, commit() turns it into PWM in one pass */
+typedef struct {
+    bool     power;
+    uint8_t  level;        // Matter level, 0-254
+    led_color_mode_t mode; // Which of the color values below is in use
+    uint16_t x;            // Matter CurrentX/CurrentY
+    uint16_t y;
+    uint16_t mireds;       // Matter ColorTemperatureMireds
+    uint16_t hue;          // EnhancedCurrentHue scale, 65536 = 360 degrees
+    uint8_t  saturation;   // Matter CurrentSaturation, 0-254
+    led_color_loop_t loop;
+} led_state_t;
+
+/* A state with the channel color it converts to, the color math already done */
+typedef struct {
+    uint32_t      key;   // Scene key, unused by the color cache
+    uint32_t      used;  // Last use, least recently used goes first. 0 is empty
+    led_state_t   state;
+    RGB_CCT_q15_t color;
+} led_cache_entry_t;
+
 class LED_Driver {
+    friend class LED_Driver_Bench; // host/led_bench.cpp times the private per-channel steps
+
     public:
     LED_Driver(LED_GPIO_MAP gpioChannelConfig);
     ~LED_Driver();
 
     public:
-    /* LED Driver Functions, mapped to the matter commands and attempt to handle those specific cases */
+    /* LED Driver Functions, mapped to the matter attributes. These only stage the new state,
+     * commit() applies everything staged since the last commit in a single color/PWM pass */
         esp_err_t set_power(bool power);
         esp_err_t set_brightness(uint8_t brightness);
-        esp_err_t set_temperature(uint32_t temperature);
-        esp_err_t set_colorXY(long x, long y);
+        esp_err_t set_temperature(uint16_t mireds);
+        esp_err_t set_colorXY(long x, long y); // -1 leaves that half unchanged
+        esp_err_t set_hue(uint8_t hue);                   // CurrentHue, 0-254
+        esp_err_t set_enhanced_hue(uint16_t enhanced_hue); // EnhancedCurrentHue, full 16 bit
+        esp_err_t set_saturation(uint8_t saturation);
+
+        esp_err_t commit();
+
+        esp_err_t set_dimming_curve(led_dimming_curve_t curve);
+    /* ---------------------------------------------------------------------------------------------- */
+
+    public:
+    /* Fast boot. The constructor puts the fixture's last settled output straight back on LEDC, long before Matter is up,
+     * and commit() keeps that snapshot current. The first commit after the data model is loaded reconciles */
+        esp_err_t restore_output();
+        void      get_output(led_output_t *out) const;
+    /* ---------------------------------------------------------------------------------------------- */
+
+    public:
+    /* Hardware fades, started from the Matter commands with their target and TransitionTime. Staged like the setters,
+     * the fade starts on the next commit(). While one runs, the intermediate values the stack steps through are dropped,
+     * a value that isn't on the way to the target (another command, another controller) ends that and applies */
+        esp_err_t fade_brightness(uint8_t brightness, uint32_t transition_ms, bool turn_on);
+        esp_err_t fade_temperature(uint16_t mireds, uint32_t transition_ms);
+        esp_err_t fade_colorXY(uint16_t x, uint16_t y, uint32_t transition_ms);
+        esp_err_t fade_hue_saturation(uint16_t enhanced_hue, uint8_t saturation, uint32_t transition_ms);
+        esp_err_t stop_fade();
+    /* ---------------------------------------------------------------------------------------------- */
+
+    public:
+    /* Color loop. The attributes are staged like the others and commit() starts, restarts or stops the loop.
+     * While it runs, color_loop_step() is called once per frame and walks a precomputed hue wheel straight to LEDC */
+        esp_err_t set_color_loop_active(bool active);
+        esp_err_t set_color_loop_direction(bool up);
+        esp_err_t set_color_loop_time(uint16_t seconds);
+        esp_err_t set_color_loop_start_hue(uint16_t enhanced_hue);
+
+        esp_err_t color_loop_step();
+        bool      color_loop_running() const { return loop_running; }
+        uint16_t  color_loop_hue() const { return state.hue; }
+    /* ---------------------------------------------------------------------------------------------- */
+
+    public:
+    /* Scenes. store_scene() keeps the committed state with its channel color under the key, recall_scene() stages it
+     * again without any color math, commit() is then one multiply per channel. ESP_ERR_NOT_FOUND if it is not cached.
+     * forget_scenes() drops every entry whose key matches under the mask, for scenes the stack changed or removed */
+        esp_err_t store_scene(uint32_t key);
+        esp_err_t recall_scene(uint32_t key, uint32_t transition_ms);
+        void      forget_scenes(uint32_t key, uint32_t mask);
     /* ---------------------------------------------------------------------------------------------- */
 
     private:
@@ -66,41 +172,85 @@ class LED_Driver {
         esp_err_t enable_LEDC_Channel(led_channel_info_t config);
         
         esp_err_t set_duty();
-        esp_err_t set_channel_duty(float *new_Color, float *old_Color, led_channel_info_t channel);
-        uint32_t  duty_to_pwm(float color);
+        void      update_color();
+        esp_err_t set_channel_duty(q15_t color, led_channel_info_t channel);
+        esp_err_t set_strip_duty();
+        uint32_t  duty_to_pwm(q15_t color);
+        uint32_t  duty_to_fine(q15_t color);
+
+        void      apply_color_loop();
+        void      build_color_wheel();
+        uint16_t  color_loop_position(int64_t now);
+        void      color_loop_color();
+
+        bool      fade_HS_running() const;
+
+        bool      color_cache_lookup();
+        void      color_cache_insert();
     /* ---------------------------- */
     
     private:
-        ledc_timer_t timer = LEDC_TIMER_0;
+        ledc_timer_t timer = LEDC_TIMER_MAX;
+        uint32_t     layout = {}; // Wiring tag of the snapshot slot, CONFIG_LED_SNAPSHOT
         const char *TAG = "led_driver";
         
     private:
         uint8_t  nChannels = {};
-        uint32_t max_pwm   = {};
         LED_GPIO_MAP pins = {};
+        const uint16_t *curve_lut = {}; // Level -> PWM count table of the active dimming curve
+        const uint32_t *curve_fine = {}; // Same in dither units, with CONFIG_LED_DRIVER_DITHER
+        bool white_extract = {};        // xy colors put their white part on W/WW (CONFIG_LED_DRIVER_WHITE_EXTRACT)
+        bool rgb_only = {};             // No white channel at all, color temperatures are mixed from RGB
 
     private:
-        bool power   = {}; // If any of the lights are on
         bool channel_enabled[ESP32C6_MAX_CHANNELS] = {}; // If the channel is enabled or not
+        uint16_t channel_counts[ESP32C6_MAX_CHANNELS] = {}; // PWM counts each channel was last set to (fade target)
+        uint32_t channel_fine[ESP32C6_MAX_CHANNELS]   = {}; // Same in dither units with CONFIG_LED_DRIVER_DITHER, change detection
 
-        uint8_t bri  = {}; // Bri is the currently applied brightness
-        uint8_t obri = {}; // oBri is the old brightness value for when power is resumed
+        int          strip_segment = -1; // Segment of the addressable strip, -1 on LEDC fixtures
+        led_output_t strip_counts  = {}; // Counts the segment was last set to (fade target)
 
-        RGB_CCT_Duty_t RGB  = {};  // RGB is the currently applied value
-        RGB_CCT_Duty_t nRGB = {};  // nRGB is the working values to be applied
+        led_state_t state = {};      // Staged state, what the next commit() applies
+        bool color_dirty  = {};      // Color values changed since the last commit
+        bool output_dirty = {};      // Anything changed since the last commit
 
-        XY_color_t XY = {-1, -1}; // This is the XY value that will be converted to RGB once both values are present
-};
+        uint8_t bri  = {}; // Bri is the currently applied brightness (Matter level, 0-254)
+
+        RGB_CCT_q15_t nRGB = {};  // nRGB is the working values to be applied
+
+    private:
+        uint32_t fade_ms = {}; // Transition used by the next commit(), 0 is instant
+        int64_t  channel_fade_end[ESP32C6_MAX_CHANNELS] = {}; // esp_timer time the hardware fade on each channel ends
+
+        int64_t    level_fade_end   = {}; // Until when intermediate level/color writes are dropped
+        int64_t    color_fade_end   = {};
+        XY_color_t fade_XY          = {}; // Targets of the running color fade, those are let through
+        uint16_t   fade_mireds      = {};
+        uint16_t   level_fade_step  = {}; // Last step seen of each fade, starting at the value it left from. A write
+        XY_color_t fade_XY_step     = {}; // that isn't between this and the target ends the window
+        uint16_t   fade_mireds_step = {};
+        led_color_mode_t color_fade_mode = {}; // Color fade the window is for, hue/saturation writes check it
+        uint16_t   fade_HS_hue             = {};
+        uint8_t    fade_HS_saturation      = {};
+        uint16_t   fade_HS_hue_step        = {};
+        uint8_t    fade_HS_saturation_step = {};
 
-/* LEDC Timer Configuration */
-static const ledc_timer_config_t ledc_timer = {
-    .speed_mode = LEDC_SPEED_MODE,           // timer mode
-    .duty_resolution = LEDC_TIMER_13_BIT,    // resolution of PWM duty
-    .timer_num = LEDC_TIMER,                 // timer index
-    .freq_hz = 5000,                         // frequency of PWM signal
-    .clk_cfg = LEDC_AUTO_CLK                 // Auto select the source clock
+    private:
+        bool hue_enhanced = {}; // Hue came from EnhancedCurrentHue, its 8 bit CurrentHue shadow is ignored
+
+    private:
+        bool       loop_dirty      = {}; // ColorLoop attributes changed since the last commit
+        bool       loop_running    = {};
+        int64_t    loop_start_us   = {}; // esp_timer time the loop was at loop_origin
+        uint16_t   loop_origin     = {};
+        RGB_q15_t *loop_wheel      = {}; // LED_COLOR_LOOP_WHEEL_SIZE entries, allocated on the first loop
+        uint8_t    loop_wheel_sat  = {}; // Saturation the wheel was built for
+
+    private:
+        led_cache_entry_t scene_cache[LED_SCENE_CACHE_SIZE] = {}; // Stored scenes
+        led_cache_entry_t color_cache[LED_SCENE_CACHE_SIZE] = {}; // Recently converted color values
+        uint32_t          cache_clock = {};                      // Stamps the entries' last use
 };
-/* ------------------------ */
 
 
 #ifdef __cplusplus
@@ -0,0 +1,71 @@
+#ifndef LEDLATENCY_H
+#define LEDLATENCY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <sdkconfig.h>
+#include <esp_cpu.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Stages of the attribute -> PWM path, timed with the CPU cycle counter */
+typedef enum {
+    LATENCY_DISPATCH = 0, // Attribute callback / command hook until the render task picks the change up
+    LATENCY_COLOR,        // Color conversion (update_color)
+    LATENCY_DUTY,         // Level curve * color -> PWM counts, per channel
+    LATENCY_LEDC,         // LEDC fade stop + duty update, per channel
+    LATENCY_TOTAL,        // Oldest change in a render pass until its commit returned
+    LATENCY_STAGE_MAX,
+} led_latency_stage_t;
+
+/* LEDC writes the driver issued, and the ones it skipped because the channel already had that value or state */
+typedef enum {
+    LEDC_WRITE_DUTY = 0, // Duty update or fade start
+    LEDC_WRITE_ENABLE,   // ledc_channel_config
+    LEDC_WRITE_DISABLE,  // ledc_stop
+    LEDC_WRITE_KIND_MAX,
+} led_write_kind_t;
+
+/* Bucket n holds samples of [2^n, 2^(n+1)) cycles */
+#define LATENCY_BUCKETS 32
+
+typedef struct {
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    uint64_t sum;
+    uint32_t buckets[LATENCY_BUCKETS];
+} led_latency_hist_t;
+
+static inline uint32_t led_latency_now(void) {
+    return (uint32_t)esp_cpu_get_cycle_count();
+}
+
+/* Adds one sample, start is a led_latency_now() value. Only the render task records */
+void led_latency_record(led_latency_stage_t stage, uint32_t start);
+
+/* Counts one LEDC write, or one that was elided */
+void led_latency_count_write(led_write_kind_t kind, bool elided);
+
+/* Prints count/min/mean/p99/max per stage in us, plus the non-empty buckets and the write counters */
+void led_latency_dump(FILE *out);
+void led_latency_reset(void);
+
+#if CONFIG_LED_LATENCY_STATS
+#define LED_LATENCY_START()              led_latency_now()
+#define LED_LATENCY_RECORD(stage, start) led_latency_record((stage), (start))
+#define LED_LATENCY_WRITE(kind, elided)  led_latency_count_write((kind), (elided))
+#else
+#define LED_LATENCY_START()              0
+#define LED_LATENCY_RECORD(stage, start) do { (void)(start); } while (0)
+#define LED_LATENCY_WRITE(kind, elided)  do { } while (0)
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LEDLATENCY_H
@@ -0,0 +1,38 @@
+#ifndef LEDSNAPSHOT_H
+#define LEDSNAPSHOT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <esp_err.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* One slot per fixture, keyed by its index in the app's fixture table: the LEDC fixtures (ESP32C6_MAX_TIMERS)
+ * and the strip segments (LED_STRIP_MAX_SEGMENTS) after them */
+#define LED_SNAPSHOT_SLOTS 12
+
+/* Final PWM counts of one fixture */
+typedef struct {
+    uint16_t red;
+    uint16_t green;
+    uint16_t blue;
+    uint16_t white;
+    uint16_t warmwhite;
+} led_output_t;
+
+/* Last output stored for the slot. RTC memory first, it survives software resets, panics and brownouts,
+ * NVS after a power cycle. layout identifies the wiring of the fixture asking; an output stored for another one
+ * (the fixture table changed since) is stale. ESP_ERR_NOT_FOUND if there is no output for this layout */
+esp_err_t led_snapshot_load(size_t slot, uint32_t layout, led_output_t *out);
+
+/* Records the output the slot settles at, with the fixture's layout. RTC memory right away, NVS once it stayed the
+ * same for CONFIG_LED_SNAPSHOT_NVS_DELAY_MS so a dim or a color loop doesn't wear the flash. Only the render task stores */
+void led_snapshot_store(size_t slot, uint32_t layout, const led_output_t *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LEDSNAPSHOT_H
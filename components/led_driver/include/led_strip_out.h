@@ -0,0 +1,60 @@
+#ifndef LEDSTRIPOUT_H
+#define LEDSTRIPOUT_H
+
+#include <stdint.h>
+#include <esp_err.h>
+#include <sdkconfig.h>
+#include "./led_snapshot.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Addressable strip output, WS2812 (GRB) or SK6812 (GRBW) pixels through espressif/led_strip, SPI with DMA or RMT.
+ * The strip is split into segments, each one shows the color of one driver, all of them share one frame. A build task packs every segment into the
+ * frame (pack_grb_n()), a send task hands the changed pixels to led_strip and waits out the transfer; the frame and led_strip's own pixel buffer are
+ * the two buffers, so frame N+1 is built while frame N is on the wire. Fades are stepped in software, one frame each */
+#ifndef CONFIG_LED_DRIVER_STRIP_GPIO
+#define CONFIG_LED_DRIVER_STRIP_GPIO 8
+#endif
+#ifndef CONFIG_LED_DRIVER_STRIP_LENGTH
+#define CONFIG_LED_DRIVER_STRIP_LENGTH 60
+#endif
+#ifndef CONFIG_LED_DRIVER_STRIP_FPS
+#define CONFIG_LED_DRIVER_STRIP_FPS 100
+#endif
+
+#define LED_STRIP_MAX_SEGMENTS 8
+#define LED_STRIP_COUNT_BITS   13 // Segments take counts like LEDC (LED_DUTY_RESOLUTION), pixels get the top 8 bits
+#define LED_STRIP_TASK_PRIORITY 9 // Just below the render task, a frame is never more urgent than a new target
+
+#if CONFIG_LED_DRIVER_STRIP_RGBW
+#define LED_STRIP_BYTES_PER_PIXEL 4 // G, R, B, W
+#else
+#define LED_STRIP_BYTES_PER_PIXEL 3 // G, R, B
+#endif
+
+/* Creates the strip device and both tasks, once. Called by the first add_segment() */
+esp_err_t led_strip_out_init(void);
+
+/* Claims pixels first .. first + count - 1. ESP_ERR_INVALID_ARG if they run past the strip,
+ * ESP_ERR_NO_MEM once LED_STRIP_MAX_SEGMENTS are taken */
+esp_err_t led_strip_out_add_segment(uint16_t first, uint16_t count, int *segment);
+
+/* Moves a segment to counts (red, green, blue, white; warmwhite is not used, a pixel has one white at most),
+ * linearly over fade_ms from what it shows now. What is left of a running fade carries over, like on LEDC */
+esp_err_t led_strip_out_set(int segment, const led_output_t *counts, uint32_t fade_ms);
+
+/* Ends a running fade where it is now, like ledc_fade_stop(). out gets the counts it stopped at */
+void led_strip_out_hold(int segment, led_output_t *out);
+
+/* No frame is built while a batch is open, whatever the segments were set to in between goes out in one frame once
+ * the outermost batch ends. For callers updating several segments in one go, e.g. all endpoints of one interaction */
+void led_strip_out_batch_begin(void);
+void led_strip_out_batch_end(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LEDSTRIPOUT_H
@@ -0,0 +1,82 @@
+#ifndef LEDTRACE_H
+#define LEDTRACE_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <sdkconfig.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef CONFIG_LED_TRACE_LEVEL
+#define CONFIG_LED_TRACE_LEVEL 0
+#endif
+
+/* Trace events: X(name, id, level, format). Level 1 is per update, level 2 is per channel / per dropped step.
+ * The format is never used on the device, tools/led_trace_decode.py reads it from this file to print the records,
+ * {0} {1} {2} are arg0..arg2 (Python format syntax). Keep ids stable so older dumps still decode */
+#define LED_TRACE_EVENTS(X) \
+    X(TRACE_SET_POWER,        1,  1, "set_power {0}") \
+    X(TRACE_SET_LEVEL,        2,  1, "set_brightness {0}") \
+    X(TRACE_SET_TEMPERATURE,  3,  1, "set_temperature {1} mireds") \
+    X(TRACE_SET_XY,           4,  1, "set_colorXY x={1} y={2}") \
+    X(TRACE_COMMIT,           5,  1, "commit bri={0} mode={1} fade={2}ms") \
+    X(TRACE_CHANNEL_DUTY,     6,  2, "channel {0} color={1} pwm={2}") \
+    X(TRACE_FADE_START,       7,  1, "fade kind={0} target={1:#x} time={2}ms") \
+    X(TRACE_FADE_STOP,        8,  1, "fade stop") \
+    X(TRACE_STEP_DROPPED,     9,  2, "dropped step kind={0} value={1}") \
+    X(TRACE_APP_ATTRIBUTE,    10, 1, "attribute cluster={1:#06x} attribute={2:#06x}") \
+    X(TRACE_APP_COMMAND,      11, 1, "command type={0} target={1:#x} time={2}ms") \
+    X(TRACE_APP_QUEUE_FULL,   12, 1, "render queue full, resync") \
+    X(TRACE_APP_RESYNC,       13, 1, "resync from data model, endpoints={1:#x}") \
+    X(TRACE_SET_HS,           14, 1, "set_hue/saturation src={0} hue={1} sat={2}") \
+    X(TRACE_COLOR_LOOP,       15, 1, "color loop running={0} hue={1:#x} time={2}s") \
+    X(TRACE_SCENE,            16, 1, "scene op={0} (store, recall, forget) key={1:#x} hit={2}") \
+    X(TRACE_STRIP_FRAME,      17, 2, "strip frame fading={0} segments={1:#x} of {2}") \
+    X(TRACE_FADE_WINDOW_END,  18, 1, "fade window ended kind={0} by {1} {2}")
+
+#define LED_TRACE_ENUM(name, id, level, fmt) name = id, name##_LEVEL = level,
+typedef enum {
+    LED_TRACE_EVENTS(LED_TRACE_ENUM)
+} led_trace_event_t;
+#undef LED_TRACE_ENUM
+
+/* "kind" argument of the fade and dropped step events */
+enum {
+    LED_TRACE_KIND_LEVEL       = 0,
+    LED_TRACE_KIND_TEMPERATURE = 1,
+    LED_TRACE_KIND_XY          = 2,
+    LED_TRACE_KIND_HUE         = 3,
+};
+
+/* One fixed size record, written as is into the ring */
+typedef struct {
+    uint32_t timestamp; // esp_timer time in us, low 32 bits
+    uint16_t event;
+    uint16_t arg0;
+    uint32_t arg1;
+    uint32_t arg2;
+} led_trace_record_t;
+
+void led_trace_write(uint16_t event, uint16_t arg0, uint32_t arg1, uint32_t arg2);
+
+/* Prints the buffer oldest first, one "LEDTRACE" line of hex fields per record, for the host decoder */
+void led_trace_dump(FILE *out);
+void led_trace_clear(void);
+
+#if CONFIG_LED_TRACE_LEVEL > 0
+#define LED_TRACE(event, arg0, arg1, arg2) do { \
+        if (event##_LEVEL <= CONFIG_LED_TRACE_LEVEL) { \
+            led_trace_write((event), (uint16_t)(arg0), (uint32_t)(arg1), (uint32_t)(arg2)); \
+        } \
+    } while (0)
+#else
+#define LED_TRACE(event, arg0, arg1, arg2) do { } while (0)
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LEDTRACE_H
@@ -0,0 +1,54 @@
+#ifndef KELVIN_REF_H
+#define KELVIN_REF_H
+
+#include <cx_math.hpp>
+
+/* Compile time color references shared by the tables built from them */
+namespace cx {
+
+struct rgb_ref_t {
+    double r, g, b;
+};
+
+/* Copy of colorTemperatureToRGB(). temp is kelvin / 100, the channels come out as 0-255 like the float version works internally */
+constexpr rgb_ref_t kelvin_to_rgb(double temp) {
+    double r = 0, g = 0, b = 0;
+
+    if (temp <= 66) {
+        r = 255;
+        g = clamp(99.4708025861 * log(temp) - 161.1195681661, 0, 255);
+        b = (temp <= 19) ? 0 : clamp(138.5177312231 * log(temp - 10) - 305.0447927307, 0, 255);
+    } else {
+        r = 329.698727446 * pow(temp - 60, -0.1332047592);
+        g = 288.1221695283 * pow(temp - 60, -0.0755148492);
+        b = 255;
+    }
+    return { r, g, b };
+}
+
+/* XYZ -> linear sRGB (D65) */
+constexpr double M_XYZ_RGB_F[3][3] = {
+    {  3.2404542, -1.5371385, -0.4985314 },
+    { -0.9692660,  1.8760108,  0.0415560 },
+    {  0.0556434, -0.2040259,  1.0572252 },
+};
+
+/* Linear sRGB of a chromaticity at Y = y, normalized to the brightest channel. Out of gamut channels stay negative */
+constexpr rgb_ref_t xy_to_linear_rgb(double x, double y) {
+    double z = 1.0 - x - y;
+    double raw[3] = {};
+    double max_comp = 0;
+    for (int i = 0; i < 3; i++) {
+        raw[i] = x * M_XYZ_RGB_F[i][0] + y * M_XYZ_RGB_F[i][1] + z * M_XYZ_RGB_F[i][2];
+        max_comp = (raw[i] > max_comp) ? raw[i] : max_comp;
+    }
+
+    if (max_comp <= 0) {
+        return { 0, 0, 0 };
+    }
+    return { raw[0] / max_comp, raw[1] / max_comp, raw[2] / max_comp };
+}
+
+} // namespace cx
+
+#endif // KELVIN_REF_H
@@ -0,0 +1,119 @@
+#include <esp_timer.h>
+#include <led_driver.h>
+#include <led_trace.h>
+#include <helpers.hpp>
+
+/* ColorLoop attributes, staged. commit() decides what they mean for the running loop */
+esp_err_t LED_Driver::set_color_loop_active(bool active){
+    state.loop.active = active;
+
+    loop_dirty   = true;
+    output_dirty = true;
+    return ESP_OK;
+}
+
+esp_err_t LED_Driver::set_color_loop_direction(bool up){
+    state.loop.up = up;
+
+    loop_dirty   = true;
+    output_dirty = true;
+    return ESP_OK;
+}
+
+esp_err_t LED_Driver::set_color_loop_time(uint16_t seconds){
+    state.loop.time_s = seconds;
+
+    loop_dirty   = true;
+    output_dirty = true;
+    return ESP_OK;
+}
+
+esp_err_t LED_Driver::set_color_loop_start_hue(uint16_t enhanced_hue){
+    // Only read when the loop starts, no need to touch the running one
+    state.loop.start_hue = enhanced_hue;
+    return ESP_OK;
+}
+/* ----------------------------------------------------------------- */
+
+/* Starts, restarts or stops the loop from the staged attributes. Commit only */
+void LED_Driver::apply_color_loop(){
+    int64_t now = esp_timer_get_time();
+
+    if (state.loop.active && !loop_running) {
+        loop_origin = state.loop.start_hue;
+        hue_enhanced = true;
+        state.mode  = LED_COLOR_MODE_HS;
+    }
+    else if (state.loop.active) {
+        // Direction or time changed, carry on from the current hue
+        loop_origin = color_loop_position(now);
+    }
+    else if (loop_running) {
+        // Freeze where it is, the stack writes the stored hue back right after
+        state.hue   = color_loop_position(now);
+        color_dirty = true;
+    }
+
+    loop_running  = state.loop.active;
+    loop_start_us = now;
+    loop_dirty    = false;
+
+    LED_TRACE(TRACE_COLOR_LOOP, loop_running, loop_origin, state.loop.time_s);
+}
+/* ----------------------------------------------------------------- */
+
+/* One full saturation wheel, rebuilt only when the saturation changes */
+void LED_Driver::build_color_wheel(){
+    if (!loop_wheel) {
+        loop_wheel = new RGB_q15_t[LED_COLOR_LOOP_WHEEL_SIZE];
+    }
+
+    q15_t saturation = (uint32_t)state.saturation * Q15_ONE / MATTER_SATURATION;
+    for (int i = 0; i < LED_COLOR_LOOP_WHEEL_SIZE; i++) {
+        hsv_to_duty_q15(i * (65536 / LED_COLOR_LOOP_WHEEL_SIZE), saturation, &loop_wheel[i]);
+        srgb_to_linear_q15(&loop_wheel[i]); // Linear like a static HS color, the loop lerps in duty
+    }
+    loop_wheel_sat = state.saturation;
+}
+/* ----------------------------------------------------------------- */
+
+/* Hue the loop is at, from the elapsed time so late frames never accumulate drift */
+uint16_t LED_Driver::color_loop_position(int64_t now){
+    int64_t  turn_us = std::max<uint16_t>(state.loop.time_s, 1) * 1000000LL; // Time may not have been written yet
+    uint32_t delta   = ((now - loop_start_us) % turn_us) * 65536 / turn_us;
+
+    return state.loop.up ? (uint16_t)(loop_origin + delta) : (uint16_t)(loop_origin - delta);
+}
+/* ----------------------------------------------------------------- */
+
+/* Current loop hue into nRGB, two wheel entries and a lerp per channel */
+void LED_Driver::color_loop_color(){
+    if (!loop_wheel || loop_wheel_sat != state.saturation) {
+        build_color_wheel();
+    }
+
+    state.hue = color_loop_position(esp_timer_get_time());
+
+    constexpr int SHIFT = 16 - __builtin_ctz(LED_COLOR_LOOP_WHEEL_SIZE);
+    const RGB_q15_t &a = loop_wheel[state.hue >> SHIFT];
+    const RGB_q15_t &b = loop_wheel[((state.hue >> SHIFT) + 1) & (LED_COLOR_LOOP_WHEEL_SIZE - 1)];
+    int32_t frac = state.hue & ((1 << SHIFT) - 1);
+
+    nRGB.red       = a.red   + (((b.red   - a.red)   * frac) >> SHIFT);
+    nRGB.green     = a.green + (((b.green - a.green) * frac) >> SHIFT);
+    nRGB.blue      = a.blue  + (((b.blue  - a.blue)  * frac) >> SHIFT);
+    nRGB.white     = 0;
+    nRGB.warmwhite = 0;
+}
+/* ----------------------------------------------------------------- */
+
+/* One frame of the loop. Goes straight to LEDC, nothing passes through the Matter attributes */
+esp_err_t LED_Driver::color_loop_step(){
+    if (!loop_running || bri == 0) {
+        return ESP_OK;
+    }
+
+    color_loop_color();
+    return set_duty();
+}
+/* ----------------------------------------------------------------- */
@@ -0,0 +1,178 @@
+#include <led_dither.h>
+#include <esp_attr.h>
+#include <esp_log.h>
+#include <freertos/FreeRTOS.h>
+#include <driver/gptimer.h>
+#include <hal/ledc_hal.h>
+#include <hal/ledc_ll.h>
+
+static const char *TAG = "led_dither";
+
+static_assert(LED_DITHER_BITS <= LEDC_LL_FRACTIONAL_BITS, "LEDC keeps no more fraction than this");
+
+typedef struct {
+    int64_t  value;      // Current duty, Q16 of dither units (counts << LED_DITHER_BITS)
+    int64_t  step;       // Added to value every tick while fading
+    uint32_t ticks;      // Fade ticks left, the ISR only steps channels that have some
+    uint32_t target;     // Duty the fade ends at, dither units
+    uint32_t duty;       // Dither units last written to LEDC
+    bool     configured; // Channel set up for plain duty updates (no hardware fade steps)
+} led_dither_channel_t;
+
+static led_dither_channel_t dither[LEDC_CHANNEL_MAX];
+static ledc_hal_context_t   dither_hal;
+static gptimer_handle_t     dither_timer   = nullptr;
+static bool                 dither_running = false;
+static portMUX_TYPE         dither_lock    = portMUX_INITIALIZER_UNLOCKED; // Render task sets, the ISR steps
+
+/* The duty register keeps LEDC_LL_FRACTIONAL_BITS below the count and LEDC spreads that fraction over its periods
+ * itself, so a channel resting between two counts needs no interrupt at all. Straight to the registers, the driver
+ * API may block on its fade lock and has no way to set the fraction */
+static void IRAM_ATTR led_dither_write(ledc_channel_t channel, uint32_t duty)
+{
+    dither_hal.dev->channel_group[LEDC_LOW_SPEED_MODE].channel[channel].duty.duty =
+        duty << (LEDC_LL_FRACTIONAL_BITS - LED_DITHER_BITS);
+    ledc_hal_set_duty_start(&dither_hal, channel);
+    ledc_hal_ls_channel_update(&dither_hal, channel);
+}
+
+/* One fade step on every fading channel */
+static bool IRAM_ATTR led_dither_tick(gptimer_handle_t timer, const gptimer_alarm_event_data_t *edata, void *arg)
+{
+    bool busy = false;
+
+    portENTER_CRITICAL_ISR(&dither_lock);
+    for (int ch = 0; ch < LEDC_CHANNEL_MAX; ch++) {
+        led_dither_channel_t &d = dither[ch];
+        if (!d.ticks) {
+            continue;
+        }
+
+        d.value += d.step;
+        if (--d.ticks == 0) {
+            d.value = (int64_t)d.target << 16; // No rounding drift at the end of a fade
+        }
+
+        uint32_t duty = (uint32_t)(d.value >> 16);
+        if (duty != d.duty) {
+            led_dither_write((ledc_channel_t)ch, duty);
+            d.duty = duty;
+        }
+        busy |= (d.ticks != 0);
+    }
+    dither_running = busy;
+    portEXIT_CRITICAL_ISR(&dither_lock);
+
+    // Outside the lock. The C6 has one core, no set() can slip in between the flag and the stop
+    if (!busy) {
+        gptimer_stop(timer);
+    }
+    return false;
+}
+/* ----------------------------------------------------------------- */
+
+esp_err_t led_dither_init(void)
+{
+    if (dither_timer) {
+        return ESP_OK;
+    }
+    ledc_hal_init(&dither_hal, LEDC_LOW_SPEED_MODE);
+
+    const gptimer_config_t timer_config = {
+        .clk_src       = GPTIMER_CLK_SRC_DEFAULT,
+        .direction     = GPTIMER_COUNT_UP,
+        .resolution_hz = 1000 * 1000,
+    };
+    esp_err_t err = gptimer_new_timer(&timer_config, &dither_timer);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "No timer for dithering: %s", esp_err_to_name(err));
+        dither_timer = nullptr;
+        return err;
+    }
+
+    const gptimer_alarm_config_t alarm_config = {
+        .alarm_count  = 1000 * 1000 / CONFIG_LED_DRIVER_DITHER_HZ,
+        .reload_count = 0,
+        .flags        = { .auto_reload_on_alarm = true },
+    };
+    const gptimer_event_callbacks_t callbacks = {
+        .on_alarm = led_dither_tick,
+    };
+    err  = gptimer_set_alarm_action(dither_timer, &alarm_config);
+    err |= gptimer_register_event_callbacks(dither_timer, &callbacks, nullptr);
+    err |= gptimer_enable(dither_timer);
+    return err;
+}
+
+esp_err_t led_dither_set(ledc_channel_t channel, uint32_t duty, uint32_t fade_ms)
+{
+    if (channel >= LEDC_CHANNEL_MAX || !dither_timer) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    led_dither_channel_t &d = dither[channel];
+
+    // One regular duty write resets the channel's fade step registers, after that only the duty register is touched.
+    // A fade starts from whatever the channel shows now, e.g. a restored snapshot
+    if (!d.configured) {
+        uint32_t count = ledc_get_duty(LEDC_LOW_SPEED_MODE, channel);
+        ledc_set_duty(LEDC_LOW_SPEED_MODE, channel, count);
+        ledc_update_duty(LEDC_LOW_SPEED_MODE, channel);
+
+        portENTER_CRITICAL(&dither_lock);
+        d.configured = true;
+        d.duty  = count << LED_DITHER_BITS;
+        d.value = (int64_t)d.duty << 16;
+        portEXIT_CRITICAL(&dither_lock);
+    }
+
+    uint32_t ticks = (uint64_t)fade_ms * CONFIG_LED_DRIVER_DITHER_HZ / 1000;
+
+    portENTER_CRITICAL(&dither_lock);
+    d.target = duty;
+    d.ticks  = ticks;
+    if (ticks == 0) {
+        // Instant, written right here, the timer isn't needed for it
+        d.value = (int64_t)duty << 16;
+        d.step  = 0;
+        if (duty != d.duty) {
+            led_dither_write(channel, duty);
+            d.duty = duty;
+        }
+    } else {
+        d.step  = (((int64_t)duty << 16) - d.value) / ticks;
+    }
+
+    bool start = (ticks != 0 && !dither_running);
+    dither_running |= start;
+    portEXIT_CRITICAL(&dither_lock);
+
+    // gptimer takes its own lock, so never from inside ours
+    if (start) {
+        gptimer_start(dither_timer);
+    }
+    return ESP_OK;
+}
+
+void led_dither_hold(ledc_channel_t channel)
+{
+    if (channel >= LEDC_CHANNEL_MAX) {
+        return;
+    }
+
+    portENTER_CRITICAL(&dither_lock);
+    dither[channel].ticks  = 0;
+    dither[channel].target = (uint32_t)(dither[channel].value >> 16);
+    portEXIT_CRITICAL(&dither_lock);
+}
+
+void led_dither_release(ledc_channel_t channel)
+{
+    if (channel >= LEDC_CHANNEL_MAX) {
+        return;
+    }
+
+    portENTER_CRITICAL(&dither_lock);
+    dither[channel] = {};
+    portEXIT_CRITICAL(&dither_lock);
+}
+/* ----------------------------------------------------------------- */
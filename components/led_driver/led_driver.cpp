@@ -1,8 +1,43 @@
+#include <sdkconfig.h>
 #include <esp_log.h>
+#include <esp_timer.h>
 #include <led_driver.h>
-#include <math.h>
+#include <led_trace.h>
+#include <led_latency.h>
 #include <helpers.hpp>
-#include <inttypes.h> 
+#include <inttypes.h>
+#include <string.h>
+#if CONFIG_LED_SNAPSHOT
+#include <esp_rom_crc.h>
+#endif
+
+/* LEDC resources already handed to a fixture, shared by every driver instance */
+static uint8_t next_channel = 0;
+static uint8_t next_timer   = 0;
+
+esp_err_t led_driver_assign_channels(LED_GPIO_MAP *map) {
+    if (map->strip.count) {
+        return ESP_OK;
+    }
+
+    led_channel_info_t *colors[] = { &map->red, &map->green, &map->blue, &map->white, &map->warmwhite };
+
+    uint8_t needed = 0;
+    for (led_channel_info_t *color : colors) {
+        needed += (color->gpio != -1);
+    }
+
+    if (next_channel + needed > ESP32C6_MAX_CHANNELS || next_timer >= ESP32C6_MAX_TIMERS) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    for (led_channel_info_t *color : colors) {
+        color->channel = (color->gpio != -1) ? (ledc_channel_t)next_channel++ : LEDC_CHANNEL_MAX;
+    }
+    map->timer = (ledc_timer_t)next_timer++;
+    return ESP_OK;
+}
+/* -------------------------------------------------------- */
 
 /* Generates the channel configs, then initialize them */
 esp_err_t LED_Driver::enable_LEDC_Channel(led_channel_info_t config) {
@@ -33,6 +68,10 @@ esp_err_t LED_Driver::disable_LEDC_Channel(led_channel_info_t config) {
 
     channel_enabled[config.channel] = false;
 
+#if CONFIG_LED_DRIVER_DITHER
+    led_dither_release(config.channel);
+#endif
+
     // Stop PWM and hold the pin low
     esp_err_t err = ledc_stop(LEDC_SPEED_MODE, config.channel, 0);
     err |= gpio_set_level((gpio_num_t)config.gpio, 0); // Ensure pin is held low
@@ -40,13 +79,61 @@ esp_err_t LED_Driver::disable_LEDC_Channel(led_channel_info_t config) {
     return err;
 }
 
+#if CONFIG_LED_SNAPSHOT
+/* Tags the fixture's snapshot slot with its wiring, which gpio carries which color or which pixels it drives. A table
+ * reordered or rewired since the output was stored doesn't get another fixture's output back */
+static uint32_t snapshot_layout(const LED_GPIO_MAP &pins) {
+    const int32_t wiring[] = { pins.red.gpio, pins.green.gpio, pins.blue.gpio, pins.white.gpio, pins.warmwhite.gpio,
+                               pins.strip.first, pins.strip.count };
+    return esp_rom_crc32_le(0, (const uint8_t *)wiring, sizeof(wiring));
+}
+#endif
+
 /* Initialize the led driver and the shared instance struct */
 LED_Driver::LED_Driver(LED_GPIO_MAP pins_) {
     ESP_LOGW(TAG, "Initializing light driver");
 
-    max_pwm = pow(2, 13);
+#if CONFIG_LED_DRIVER_DIMMING_CURVE_GAMMA22
+    set_dimming_curve(DIMMING_CURVE_GAMMA22);
+#elif CONFIG_LED_DRIVER_DIMMING_CURVE_LINEAR
+    set_dimming_curve(DIMMING_CURVE_LINEAR);
+#else
+    set_dimming_curve(DIMMING_CURVE_CIE);
+#endif
 
-    // Apply configuration to timer
+    pins = pins_;
+#if CONFIG_LED_SNAPSHOT
+    layout = snapshot_layout(pins);
+#endif
+
+    // Strip fixtures only need their segment, no LEDC at all
+    if (pins.strip.count) {
+#if CONFIG_LED_DRIVER_STRIP
+        esp_err_t err = led_strip_out_add_segment(pins.strip.first, pins.strip.count, &strip_segment);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "No strip segment for pixels %u+%u: %s", pins.strip.first, pins.strip.count, esp_err_to_name(err));
+        }
+        rgb_only = (LED_STRIP_BYTES_PER_PIXEL == 3);
+#if CONFIG_LED_SNAPSHOT
+        restore_output();
+#endif
+#else
+        ESP_LOGE(TAG, "Strip fixture, but CONFIG_LED_DRIVER_STRIP is off");
+#endif
+        return;
+    }
+    rgb_only = (pins.white.gpio == -1 && pins.warmwhite.gpio == -1);
+
+    // Every fixture runs on its own timer
+    timer = pins_.timer;
+
+    ledc_timer_config_t ledc_timer = {
+        .speed_mode      = LEDC_SPEED_MODE,      // timer mode
+        .duty_resolution = LED_DUTY_RESOLUTION,  // resolution of PWM duty
+        .timer_num       = timer,                // timer index
+        .freq_hz         = LEDC_PWM_FREQ_HZ,     // frequency of PWM signal
+        .clk_cfg         = LEDC_AUTO_CLK         // Auto select the source clock
+    };
     ledc_timer_config(&ledc_timer);
 
     
@@ -57,74 +144,191 @@ LED_Driver::LED_Driver(LED_GPIO_MAP pins_) {
     enable_LEDC_Channel(pins_.white);
     enable_LEDC_Channel(pins_.warmwhite);
 
-    pins = pins_;
+#if CONFIG_LED_DRIVER_WHITE_EXTRACT
+    // Needs both whites, the blend is what carries the target's white point
+    white_extract = (pins.white.gpio != -1 && pins.warmwhite.gpio != -1);
+#endif
+
+    // The fade service is shared by all instances, only the first one installs it
+    static bool fade_installed = false;
+    if (!fade_installed) {
+        ledc_fade_func_install(0);
+        fade_installed = true;
+    }
+
+#if CONFIG_LED_DRIVER_DITHER
+    led_dither_init();
+#endif
+
+#if CONFIG_LED_SNAPSHOT
+    restore_output();
+#endif
+}
+/* -------------------------------------------------------- */
 
-    ledc_fade_func_install(0);
+/* Fixtures live as long as the firmware, this only matters for the host build */
+LED_Driver::~LED_Driver() {
+    delete[] loop_wheel;
 }
 /* -------------------------------------------------------- */
 
 
-/* Sets the duty cycle to zero, effectively turning off the LEDs */
+/* Stages the power state, the level is kept so it comes back when turned on again */
 esp_err_t LED_Driver::set_power(bool new_power){
-    ESP_LOGW(TAG, "Setting power to: %d", power);
-    power = new_power;
+    LED_TRACE(TRACE_SET_POWER, new_power, 0, 0);
+    state.power = new_power;
+    level_fade_end = 0; // On/Off always applies, a level fade in progress only keeps the remaining time
 
-    if (power) {
-        bri = (obri == 0) ? DEFAULT_BRIGHTNESS : bri; // If brightness was 0 set to default
-    } 
-    else {
-        obri = bri; // Save the old brightness for when we turn back on
-        bri = 0;    // Set brightness to 0
+    output_dirty = true;
+    return ESP_OK;
+}
+/* -------------------------------------------------------- */
+
+/* Selects the level -> PWM count curve used for brightness */
+esp_err_t LED_Driver::set_dimming_curve(led_dimming_curve_t curve) {
+    if (curve >= DIMMING_CURVE_MAX) {
+        return ESP_ERR_INVALID_ARG;
     }
 
-    return set_brightness(bri);
+    curve_lut  = dimming_curve_table(curve);
+    curve_fine = dimming_curve_table_fine(curve);
+    return ESP_OK;
 }
-/* -------------------------------------------------------- */
+/* ---------------------------------------------------------------- */
 
 /* Converts the internal duty cycle format to the needed PWM value */
-uint32_t LED_Driver::duty_to_pwm(float color) {
-    // Use integer math for efficiency on embedded systems
-    uint32_t value = (uint32_t)((color * bri * max_pwm) / 100.0f);
+uint32_t LED_Driver::duty_to_pwm(q15_t color) {
+    // Curve table gives the counts for the level, the color scales that down (<= 2^13 * 2^15)
+    return ((uint32_t)curve_lut[bri] * color) >> Q15_SHIFT;
+}
 
-    ESP_LOGW(TAG, "Color: %f, Brightness: %d, PWM: %" PRIu32, color, bri, value);
-    return value;
+/* Same in dither units, counts << LED_DITHER_BITS (<= 2^16 * 2^15) */
+uint32_t LED_Driver::duty_to_fine(q15_t color) {
+    return ((uint32_t)curve_fine[bri] * color) >> Q15_SHIFT;
 }
 /* ---------------------------------------------------------------- */
 
-esp_err_t LED_Driver::set_channel_duty(float *new_color, float *old_color, led_channel_info_t channelConfig){
-    // If the channel isn't enabled, or if the color/brightness hasn't changed skip
-    if(new_color == old_color){
-        // Nothing changed on this channel skip
+/* Moves one channel to the color at the current level. LEDC is only written when the final count (dither units with
+ * CONFIG_LED_DRIVER_DITHER) or the channel's enable state differs from what the hardware already has */
+esp_err_t LED_Driver::set_channel_duty(q15_t color, led_channel_info_t channelConfig){
+    // Color not wired on this fixture
+    if (channelConfig.gpio == -1) {
         return ESP_OK;
     }
-
-    // Update Tracker Used To Speed Up Future Checks
-    old_color = new_color;
-
-    // Disable channel if we are trying to set it to 0
-    if (new_color == 0 && channel_enabled[channelConfig.channel] == true){
-        disable_LEDC_Channel(channelConfig);
+    ledc_channel_t channel = channelConfig.channel;
+
+    uint32_t start = LED_LATENCY_START();
+#if CONFIG_LED_DRIVER_DITHER
+    uint32_t fine  = duty_to_fine(color);
+    uint32_t duty  = (fine + LED_DITHER_ONE / 2) >> LED_DITHER_BITS;
+#else
+    uint32_t duty  = duty_to_pwm(color);
+    uint32_t fine  = duty;
+#endif
+    LED_LATENCY_RECORD(LATENCY_DUTY, start);
+
+    uint32_t fade = fade_ms;
+    int64_t  now  = esp_timer_get_time();
+
+    // Already there, or already fading there. A stopped channel already shows 0
+    if (channel_enabled[channel] ? fine == channel_fine[channel] : fine == 0) {
+        LED_LATENCY_WRITE(LEDC_WRITE_DUTY, true);
         return ESP_OK;
-    } 
+    }
 
-    // Enable channel if it was off and we are trying to set a value
-    if (new_color != 0 && channel_enabled[channelConfig.channel] == false){
+    // Instantly off stops the channel, a fade to 0 runs on the enabled channel like any other
+    if (fine == 0 && fade == 0 && now >= channel_fade_end[channel]) {
+        LED_LATENCY_WRITE(LEDC_WRITE_DISABLE, !channel_enabled[channel]);
+        channel_counts[channel] = 0;
+        channel_fine[channel]   = 0;
+        return disable_LEDC_Channel(channelConfig);
+    }
+
+    if (!channel_enabled[channel]) {
+        LED_LATENCY_WRITE(LEDC_WRITE_ENABLE, false);
         enable_LEDC_Channel(channelConfig);
     }
-    
-    return ledc_set_duty_and_update(LEDC_SPEED_MODE, channelConfig.channel, duty_to_pwm(*new_color), 0);
+
+    LED_LATENCY_WRITE(LEDC_WRITE_DUTY, false);
+    LED_TRACE(TRACE_CHANNEL_DUTY, channel, color, duty);
+    channel_counts[channel] = duty;
+    channel_fine[channel]   = fine;
+    esp_err_t err;
+
+    start = LED_LATENCY_START();
+
+#if CONFIG_LED_DRIVER_DITHER
+    // The dither ISR does the fade as well, in fine steps, and restarts from where the last one got to
+    if (now < channel_fade_end[channel]) {
+        fade = std::max<uint32_t>(fade, (channel_fade_end[channel] - now) / 1000);
+    }
+    channel_fade_end[channel] = (fade == 0) ? 0 : now + fade * 1000LL;
+    err = led_dither_set(channel, fine, fade);
+#else
+    // The LEDC driver blocks any duty change until a running fade ends, so stop it first.
+    // What was left of it carries over, that way a color change in the middle of a dim stays smooth
+    if (now < channel_fade_end[channel]) {
+        ledc_fade_stop(LEDC_SPEED_MODE, channel);
+        fade = std::max<uint32_t>(fade, (channel_fade_end[channel] - now) / 1000);
+    }
+
+    if (fade == 0) {
+        channel_fade_end[channel] = 0;
+        err = ledc_set_duty_and_update(LEDC_SPEED_MODE, channel, duty, 0);
+    }
+    else {
+        channel_fade_end[channel] = now + fade * 1000LL;
+        err = ledc_set_fade_time_and_start(LEDC_SPEED_MODE, channel, duty, fade, LEDC_FADE_NO_WAIT);
+    }
+#endif
+
+    LED_LATENCY_RECORD(LATENCY_LEDC, start);
+    return err;
+}
+
+/* Strip fixtures: the whole color goes to the segment at once, the strip task fades it in software. A pixel has one
+ * white at most, it gets the W/WW blend's total. Unchanged targets are not passed on, like unchanged LEDC duties */
+esp_err_t LED_Driver::set_strip_duty(){
+#if CONFIG_LED_DRIVER_STRIP
+    uint32_t start = LED_LATENCY_START();
+    led_output_t counts = {
+        .red       = (uint16_t)duty_to_pwm(nRGB.red),
+        .green     = (uint16_t)duty_to_pwm(nRGB.green),
+        .blue      = (uint16_t)duty_to_pwm(nRGB.blue),
+        .white     = (uint16_t)duty_to_pwm(std::min<uint32_t>(nRGB.white + nRGB.warmwhite, Q15_ONE)),
+        .warmwhite = 0,
+    };
+    LED_LATENCY_RECORD(LATENCY_DUTY, start);
+
+    if (memcmp(&counts, &strip_counts, sizeof(counts)) == 0) {
+        LED_LATENCY_WRITE(LEDC_WRITE_DUTY, true);
+        return ESP_OK;
+    }
+    LED_LATENCY_WRITE(LEDC_WRITE_DUTY, false);
+    strip_counts = counts;
+
+    start = LED_LATENCY_START();
+    esp_err_t err = led_strip_out_set(strip_segment, &counts, fade_ms);
+    LED_LATENCY_RECORD(LATENCY_LEDC, start);
+    return err;
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
 }
 
 /* Sets the duty cycle for each LEDC Channel */
 esp_err_t LED_Driver::set_duty(){
-    ESP_LOGW(TAG, "Setting RGB to: %f, %f, %f, %f, %f", nRGB.red, nRGB.green, nRGB.blue, nRGB.white, nRGB.warmwhite);
+    if (pins.strip.count) {
+        return set_strip_duty();
+    }
+
     esp_err_t err = ESP_OK;
 
-    err |= set_channel_duty(&nRGB.red, &RGB.red, pins.red);
-    err |= set_channel_duty(&nRGB.green, &RGB.green, pins.green);
-    err |= set_channel_duty(&nRGB.blue, &RGB.blue, pins.blue);
-    err |= set_channel_duty(&nRGB.white, &RGB.white, pins.white);
-    err |= set_channel_duty(&nRGB.warmwhite, &RGB.warmwhite, pins.warmwhite);
+    err |= set_channel_duty(nRGB.red, pins.red);
+    err |= set_channel_duty(nRGB.green, pins.green);
+    err |= set_channel_duty(nRGB.blue, pins.blue);
+    err |= set_channel_duty(nRGB.white, pins.white);
+    err |= set_channel_duty(nRGB.warmwhite, pins.warmwhite);
     
     return err;
 }
@@ -132,57 +336,452 @@ esp_err_t LED_Driver::set_duty(){
 
 
 
-/* Sets the brightness for each channel */
-esp_err_t LED_Driver::set_brightness(uint8_t brightness){
-    ESP_LOGW(TAG, "Setting brightness to: %d", brightness);
-
-    if (!power) {
-        bri = 0;
-    } else {
-        bri = brightness;
+/* True if the value is on the way from the last step to the target, the next of the stack's steps towards it.
+ * Anything else did not come from the fade, the caller ends the drop window and applies it */
+template<typename T>
+static bool fade_step(T &last, long value, long target){
+    bool step = (last <= target) ? (value >= last && value <= target) : (value <= last && value >= target);
+    if (step) {
+        last = value;
     }
+    return step;
+}
 
-    return set_duty();
+/* A hue/saturation fade's window is open */
+bool LED_Driver::fade_HS_running() const {
+    return color_fade_mode == LED_COLOR_MODE_HS && esp_timer_get_time() < color_fade_end;
 }
-/* ---------------------------------------- */
 
-/* Determines the needed channel duty cycles for a given temperature  */
-esp_err_t LED_Driver::set_temperature(uint32_t temperature){
-    ESP_LOGW(TAG, "Setting temperature to: %lu", temperature);
+/* Stages the brightness (Matter level) */
+esp_err_t LED_Driver::set_brightness(uint8_t brightness){
+    // Intermediate step of a level fade the hardware is already doing
+    if (esp_timer_get_time() < level_fade_end && brightness != state.level) {
+        if (fade_step(level_fade_step, brightness, state.level)) {
+            LED_TRACE(TRACE_STEP_DROPPED, LED_TRACE_KIND_LEVEL, 0, brightness);
+            return ESP_OK;
+        }
+        LED_TRACE(TRACE_FADE_WINDOW_END, LED_TRACE_KIND_LEVEL, 0, brightness);
+        level_fade_end = 0;
+    }
 
-    float white = clamp<float>(temperature/10000.0, 0, 1);
+    LED_TRACE(TRACE_SET_LEVEL, brightness, 0, 0);
+    state.level  = std::min<uint8_t>(brightness, MATTER_BRIGHTNESS); // Curve tables stop at the Matter max level
+    output_dirty = true;
+    return ESP_OK;
+}
+/* ---------------------------------------- */
 
-    nRGB.white = white;
-    nRGB.warmwhite = 1.0-white;
+/* Stages a color temperature (mireds) and switches to the white channels */
+esp_err_t LED_Driver::set_temperature(uint16_t mireds){
+    // Intermediate step of a color fade the hardware is already doing
+    if (esp_timer_get_time() < color_fade_end && mireds != fade_mireds) {
+        if (fade_step(fade_mireds_step, mireds, fade_mireds)) {
+            LED_TRACE(TRACE_STEP_DROPPED, LED_TRACE_KIND_TEMPERATURE, 0, mireds);
+            return ESP_OK;
+        }
+        LED_TRACE(TRACE_FADE_WINDOW_END, LED_TRACE_KIND_TEMPERATURE, 0, mireds);
+        color_fade_end = 0;
+    }
+    LED_TRACE(TRACE_SET_TEMPERATURE, 0, mireds, 0);
 
-    nRGB.red   = 0;
-    nRGB.green = 0;
-    nRGB.blue  = 0;
+    state.mode        = LED_COLOR_MODE_TEMPERATURE;
+    state.mireds = mireds;
 
-    return set_duty();
+    color_dirty  = true;
+    output_dirty = true;
+    return ESP_OK;
 }
 /* -----------------------------------------------------------------  */
 
-/* Determines the needed channel duty cycles for a given ColorXY value */
+/* Stages either or both halves of a ColorXY value, the other half keeps its last value */
 esp_err_t LED_Driver::set_colorXY(long x, long y){
-    ESP_LOGW(TAG, "Setting ColorXY to: (%lu, %lu)", x, y);
+    // Intermediate steps of a color fade the hardware is already doing
+    if (esp_timer_get_time() < color_fade_end) {
+        bool x_step = (x != -1 && x != fade_XY.x);
+        bool y_step = (y != -1 && y != fade_XY.y);
+
+        if ((!x_step || fade_step(fade_XY_step.x, x, fade_XY.x)) && (!y_step || fade_step(fade_XY_step.y, y, fade_XY.y))) {
+            x = x_step ? -1 : x;
+            y = y_step ? -1 : y;
+        }
+        else {
+            LED_TRACE(TRACE_FADE_WINDOW_END, LED_TRACE_KIND_XY, x, y);
+            color_fade_end = 0;
+        }
+    }
+
+    if (x == -1 && y == -1) {
+        LED_TRACE(TRACE_STEP_DROPPED, LED_TRACE_KIND_XY, 0, 0); // Both halves were fade steps
+        return ESP_OK;
+    }
+    LED_TRACE(TRACE_SET_XY, 0, x, y);
 
     if(x != -1){
-        XY.x = x;
+        state.x = x;
     }
     if(y != -1){
-        XY.y = y;
+        state.y = y;
     }
+    state.mode = LED_COLOR_MODE_XY;
 
-    if(XY.x != -1 && XY.y != -1) {
-        nRGB.white = 0;
-        nRGB.warmwhite = 0;
+    color_dirty  = true;
+    output_dirty = true;
+    return ESP_OK;
+}
+/* ----------------------------------------------------------------- */
+
+/* Stages a CurrentHue value and switches to hue/saturation */
+esp_err_t LED_Driver::set_hue(uint8_t hue){
+    // The color loop owns the hue while it runs. During a hue fade this is the 8 bit shadow of the stack's steps
+    if (state.loop.active || (fade_HS_running() && hue_enhanced)) {
+        LED_TRACE(TRACE_STEP_DROPPED, LED_TRACE_KIND_HUE, 0, hue);
+        return ESP_OK;
+    }
+
+    // The stack mirrors EnhancedCurrentHue into CurrentHue as its top byte, that copy would only lose precision
+    if (hue_enhanced && (state.hue >> 8) == hue) {
+        return ESP_OK;
+    }
+    LED_TRACE(TRACE_SET_HS, 0, hue, state.saturation);
 
-        xy_to_duty(XY.x, XY.y, bri, &nRGB);
-        XY = {-1, -1};
-        return set_duty();
+    hue_enhanced = false;
+    state.hue    = (uint32_t)std::min<uint8_t>(hue, MATTER_HUE) * 65536 / MATTER_HUE; // 254 is 360 degrees, wraps to 0
+    state.mode   = LED_COLOR_MODE_HS;
+
+    color_dirty  = true;
+    output_dirty = true;
+    return ESP_OK;
+}
+/* ----------------------------------------------------------------- */
+
+/* Stages an EnhancedCurrentHue value, kept at full precision */
+esp_err_t LED_Driver::set_enhanced_hue(uint16_t enhanced_hue){
+    if (state.loop.active) {
+        LED_TRACE(TRACE_STEP_DROPPED, LED_TRACE_KIND_HUE, 0, enhanced_hue);
+        return ESP_OK;
+    }
+
+    // Steps go round the shorter way, the distance left to the target only shrinks
+    if (fade_HS_running() && enhanced_hue != fade_HS_hue) {
+        int32_t left = (int16_t)(fade_HS_hue - fade_HS_hue_step);
+        int32_t went = (int16_t)(enhanced_hue - fade_HS_hue_step);
+        if ((left >= 0) ? (went >= 0 && went <= left) : (went <= 0 && went >= left)) {
+            fade_HS_hue_step = enhanced_hue;
+            LED_TRACE(TRACE_STEP_DROPPED, LED_TRACE_KIND_HUE, 0, enhanced_hue);
+            return ESP_OK;
+        }
+        LED_TRACE(TRACE_FADE_WINDOW_END, LED_TRACE_KIND_HUE, 0, enhanced_hue);
+        color_fade_end = 0;
+    }
+    LED_TRACE(TRACE_SET_HS, 1, enhanced_hue, state.saturation);
+
+    hue_enhanced = true;
+    state.hue    = enhanced_hue;
+    state.mode   = LED_COLOR_MODE_HS;
+
+    color_dirty  = true;
+    output_dirty = true;
+    return ESP_OK;
+}
+/* ----------------------------------------------------------------- */
+
+/* Stages a CurrentSaturation value, shared by both hue modes */
+esp_err_t LED_Driver::set_saturation(uint8_t saturation){
+    if (fade_HS_running() && saturation != fade_HS_saturation) {
+        if (fade_step(fade_HS_saturation_step, saturation, fade_HS_saturation)) {
+            LED_TRACE(TRACE_STEP_DROPPED, LED_TRACE_KIND_HUE, 1, saturation);
+            return ESP_OK;
+        }
+        LED_TRACE(TRACE_FADE_WINDOW_END, LED_TRACE_KIND_HUE, 1, saturation);
+        color_fade_end = 0;
     }
+    LED_TRACE(TRACE_SET_HS, 2, state.hue, saturation);
+
+    state.saturation = std::min<uint8_t>(saturation, MATTER_SATURATION);
+    state.mode       = LED_COLOR_MODE_HS;
 
+    color_dirty  = true;
+    output_dirty = true;
     return ESP_OK;
 }
+/* ----------------------------------------------------------------- */
+
+/* Converts the staged color into channel duties, only runs when a color value changed. Every path ends on linear
+ * duty, the dimming curve is the only perceptual step */
+void LED_Driver::update_color(){
+    // Color values the fixture showed recently, e.g. toggling between two presets
+    if (color_cache_lookup()) {
+        return;
+    }
+
+    if (state.mode == LED_COLOR_MODE_TEMPERATURE && rgb_only) {
+        nRGB.white     = 0;
+        nRGB.warmwhite = 0;
+
+        colorTemperatureToRGB_q15(1000000 / std::max<uint16_t>(state.mireds, 1), &nRGB);
+        srgb_to_linear_q15(&nRGB);
+    }
+    else if (state.mode == LED_COLOR_MODE_TEMPERATURE) {
+        // W/WW blend plus RGB assist, straight from the table
+        cct_mix_q15(state.mireds, &nRGB);
+    }
+    else if (state.mode == LED_COLOR_MODE_HS) {
+        nRGB.white     = 0;
+        nRGB.warmwhite = 0;
+
+        hsv_to_duty_q15(state.hue, (uint32_t)state.saturation * Q15_ONE / MATTER_SATURATION, &nRGB);
+        srgb_to_linear_q15(&nRGB);
+    }
+    else if (white_extract) {
+        xy_white_mix_q15(state.x, state.y, &nRGB);
+    }
+    else {
+        nRGB.white     = 0;
+        nRGB.warmwhite = 0;
+
+        xy_to_linear_lut(state.x, state.y, &nRGB);
+    }
+
+    color_cache_insert();
+}
+/* ----------------------------------------------------------------- */
+
+/* Applies everything staged since the last commit: color math once, then one PWM update per channel */
+esp_err_t LED_Driver::commit(){
+    if (!output_dirty) {
+        fade_ms = 0;
+        return ESP_OK;
+    }
+
+    if (loop_dirty) {
+        apply_color_loop();
+    }
+
+    if (loop_running) {
+        // Continue from wherever the loop is now, with the staged saturation
+        color_loop_color();
+    }
+    else if (color_dirty) {
+        uint32_t start = LED_LATENCY_START();
+        update_color();
+        LED_LATENCY_RECORD(LATENCY_COLOR, start);
+    }
+
+    // Turning on at level 0 would stay dark, use the default level instead
+    if (state.power) {
+        bri = (state.level == 0) ? DEFAULT_LEVEL : state.level;
+    } else {
+        bri = 0;
+    }
+
+    LED_TRACE(TRACE_COMMIT, bri, state.mode, fade_ms);
+    esp_err_t err = set_duty();
+
+#if CONFIG_LED_SNAPSHOT
+    // Fade targets, so this already is what the output settles at
+    if (pins.snapshot_slot >= 0) {
+        led_output_t out;
+        get_output(&out);
+        led_snapshot_store(pins.snapshot_slot, layout, &out);
+    }
+#endif
+
+    color_dirty  = false;
+    output_dirty = false;
+    fade_ms      = 0;
+    return err;
+}
+/* ----------------------------------------------------------------- */
+
+
+/* Replays the stored output of this fixture, instant, on the channels or the strip segment as configured */
+esp_err_t LED_Driver::restore_output(){
+#if CONFIG_LED_SNAPSHOT
+    led_output_t out;
+    if (pins.snapshot_slot < 0 || led_snapshot_load(pins.snapshot_slot, layout, &out) != ESP_OK) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    if (pins.strip.count) {
+        if (strip_segment < 0) {
+            return ESP_ERR_INVALID_STATE;
+        }
+        strip_counts = out;
+        ESP_LOGI(TAG, "Restored output %u/%u/%u/%u", out.red, out.green, out.blue, out.white);
+        return led_strip_out_set(strip_segment, &out, 0);
+    }
+
+    const struct {
+        led_channel_info_t pin;
+        uint16_t counts;
+    } channels[] = {
+        { pins.red, out.red }, { pins.green, out.green }, { pins.blue, out.blue },
+        { pins.white, out.white }, { pins.warmwhite, out.warmwhite },
+    };
+
+    esp_err_t err = ESP_OK;
+    for (const auto &c : channels) {
+        if (c.pin.gpio == -1) {
+            continue;
+        }
+        err |= ledc_set_duty_and_update(LEDC_SPEED_MODE, c.pin.channel, c.counts, 0);
+        channel_counts[c.pin.channel] = c.counts;
+#if CONFIG_LED_DRIVER_DITHER
+        channel_fine[c.pin.channel]   = (uint32_t)c.counts << LED_DITHER_BITS;
+#else
+        channel_fine[c.pin.channel]   = c.counts;
+#endif
+    }
+
+    ESP_LOGI(TAG, "Restored output %u/%u/%u/%u/%u", out.red, out.green, out.blue, out.white, out.warmwhite);
+    return err;
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+/* Current PWM counts per color, unwired colors read 0 */
+void LED_Driver::get_output(led_output_t *out) const {
+    if (pins.strip.count) {
+        *out = strip_counts;
+        return;
+    }
+
+    auto counts = [this](led_channel_info_t pin) -> uint16_t {
+        return (pin.gpio == -1) ? 0 : channel_counts[pin.channel];
+    };
+
+    out->red       = counts(pins.red);
+    out->green     = counts(pins.green);
+    out->blue      = counts(pins.blue);
+    out->white     = counts(pins.white);
+    out->warmwhite = counts(pins.warmwhite);
+}
+/* ----------------------------------------------------------------- */
+
+
+/* Fades to the level over the transition in hardware. turn_on is for the *WithOnOff commands */
+esp_err_t LED_Driver::fade_brightness(uint8_t brightness, uint32_t transition_ms, bool turn_on){
+    LED_TRACE(TRACE_FADE_START, LED_TRACE_KIND_LEVEL, brightness, transition_ms);
+
+    if (transition_ms == 0) {
+        stop_fade();
+    }
+
+    if (turn_on && brightness > 0) {
+        state.power = true;
+    }
+
+    level_fade_end  = 0;
+    level_fade_step = state.level;
+    esp_err_t err = set_brightness(brightness);
+    fade_ms = std::max(fade_ms, transition_ms);
+
+    if (transition_ms > 0) {
+        level_fade_end = esp_timer_get_time() + transition_ms * 1000LL + LED_FADE_SETTLE_US;
+    }
+    return err;
+}
+/* ----------------------------------------------------------------- */
+
+/* Fades the white channels to the temperature over the transition in hardware */
+esp_err_t LED_Driver::fade_temperature(uint16_t mireds, uint32_t transition_ms){
+    LED_TRACE(TRACE_FADE_START, LED_TRACE_KIND_TEMPERATURE, mireds, transition_ms);
+
+    if (transition_ms == 0) {
+        stop_fade();
+    }
+
+    color_fade_end   = 0;
+    fade_mireds_step = state.mireds;
+    esp_err_t err = set_temperature(mireds);
+    fade_ms = std::max(fade_ms, transition_ms);
+
+    if (transition_ms > 0) {
+        fade_mireds     = mireds;
+        color_fade_mode = LED_COLOR_MODE_TEMPERATURE;
+        color_fade_end  = esp_timer_get_time() + transition_ms * 1000LL + LED_FADE_SETTLE_US;
+    }
+    return err;
+}
+/* ----------------------------------------------------------------- */
+
+/* Fades to the enhanced hue and saturation over the transition in hardware */
+esp_err_t LED_Driver::fade_hue_saturation(uint16_t enhanced_hue, uint8_t saturation, uint32_t transition_ms){
+    LED_TRACE(TRACE_FADE_START, LED_TRACE_KIND_HUE, ((uint32_t)enhanced_hue << 16) | saturation, transition_ms);
+
+    if (transition_ms == 0) {
+        stop_fade();
+    }
+
+    color_fade_end          = 0;
+    fade_HS_hue_step        = state.hue;
+    fade_HS_saturation_step = state.saturation;
+    esp_err_t err = set_enhanced_hue(enhanced_hue);
+    err |= set_saturation(saturation);
+    fade_ms = std::max(fade_ms, transition_ms);
+
+    if (transition_ms > 0) {
+        fade_HS_hue        = enhanced_hue;
+        fade_HS_saturation = saturation;
+        color_fade_mode    = LED_COLOR_MODE_HS;
+        color_fade_end     = esp_timer_get_time() + transition_ms * 1000LL + LED_FADE_SETTLE_US;
+    }
+    return err;
+}
+/* ----------------------------------------------------------------- */
+
+/* Fades to the ColorXY value over the transition in hardware */
+esp_err_t LED_Driver::fade_colorXY(uint16_t x, uint16_t y, uint32_t transition_ms){
+    LED_TRACE(TRACE_FADE_START, LED_TRACE_KIND_XY, ((uint32_t)x << 16) | y, transition_ms);
+
+    if (transition_ms == 0) {
+        stop_fade();
+    }
+
+    color_fade_end = 0;
+    fade_XY_step   = {state.x, state.y};
+    esp_err_t err = set_colorXY(x, y);
+    fade_ms = std::max(fade_ms, transition_ms);
+
+    if (transition_ms > 0) {
+        fade_XY         = {x, y};
+        color_fade_mode = LED_COLOR_MODE_XY;
+        color_fade_end  = esp_timer_get_time() + transition_ms * 1000LL + LED_FADE_SETTLE_US;
+    }
+    return err;
+}
+/* ----------------------------------------------------------------- */
+
+/* Stops all running fades where they are, the caller re-applies the attribute values after */
+esp_err_t LED_Driver::stop_fade(){
+    LED_TRACE(TRACE_FADE_STOP, 0, 0, 0);
+    esp_err_t err = ESP_OK;
+    int64_t now = esp_timer_get_time();
+
+#if CONFIG_LED_DRIVER_STRIP
+    // Held where the software fade got to, which is then also what the next write is compared against
+    if (pins.strip.count) {
+        led_strip_out_hold(strip_segment, &strip_counts);
+    }
+#endif
+
+    for (int channel = 0; channel < ESP32C6_MAX_CHANNELS; channel++) {
+        if (now < channel_fade_end[channel]) {
+#if CONFIG_LED_DRIVER_DITHER
+            led_dither_hold((ledc_channel_t)channel);
+#else
+            err |= ledc_fade_stop(LEDC_SPEED_MODE, (ledc_channel_t)channel);
+#endif
+            // Stopped somewhere short of the target, the next write must not be taken for a repeat
+            channel_counts[channel] = ledc_get_duty(LEDC_SPEED_MODE, (ledc_channel_t)channel);
+            channel_fine[channel]   = UINT32_MAX;
+        }
+        channel_fade_end[channel] = 0;
+    }
+
+    level_fade_end = 0;
+    color_fade_end = 0;
+    return err;
+}
 /* ----------------------------------------------------------------- */
\ No newline at end of file
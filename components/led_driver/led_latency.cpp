@@ -0,0 +1,91 @@
+#include <led_latency.h>
+#include <esp_rom_sys.h>
+#include <string.h>
+
+static const char *stage_names[LATENCY_STAGE_MAX] = {
+    "dispatch",
+    "color",
+    "duty",
+    "ledc",
+    "total",
+};
+
+static const char *write_names[LEDC_WRITE_KIND_MAX] = {
+    "duty",
+    "enable",
+    "disable",
+};
+
+static led_latency_hist_t histograms[LATENCY_STAGE_MAX];
+static uint32_t writes_issued[LEDC_WRITE_KIND_MAX];
+static uint32_t writes_elided[LEDC_WRITE_KIND_MAX];
+
+void led_latency_record(led_latency_stage_t stage, uint32_t start) {
+    uint32_t cycles = led_latency_now() - start; // Wraps every ~26 s at 160 MHz, a single delta is always fine
+    led_latency_hist_t &hist = histograms[stage];
+
+    if (hist.count == 0 || cycles < hist.min) {
+        hist.min = cycles;
+    }
+    if (cycles > hist.max) {
+        hist.max = cycles;
+    }
+    hist.count++;
+    hist.sum += cycles;
+    hist.buckets[31 - __builtin_clz(cycles | 1)]++;
+}
+
+void led_latency_count_write(led_write_kind_t kind, bool elided) {
+    (elided ? writes_elided : writes_issued)[kind]++;
+}
+
+/* Upper edge of the bucket holding the 99th percentile, capped at the real max */
+static uint32_t led_latency_p99(const led_latency_hist_t &hist) {
+    uint32_t target = hist.count - hist.count / 100;
+    uint32_t seen   = 0;
+
+    for (int i = 0; i < LATENCY_BUCKETS; i++) {
+        seen += hist.buckets[i];
+        if (seen >= target) {
+            uint32_t edge = (i == 31) ? UINT32_MAX : (2u << i) - 1;
+            return (edge < hist.max) ? edge : hist.max;
+        }
+    }
+    return hist.max;
+}
+
+void led_latency_dump(FILE *out) {
+    float per_us = esp_rom_get_cpu_ticks_per_us();
+
+    fprintf(out, "%-9s %8s %10s %10s %10s %10s  (us)\n", "stage", "count", "min", "mean", "p99", "max");
+    for (int stage = 0; stage < LATENCY_STAGE_MAX; stage++) {
+        led_latency_hist_t hist = histograms[stage]; // Copy, the render task may still be recording
+        if (hist.count == 0) {
+            fprintf(out, "%-9s %8d\n", stage_names[stage], 0);
+            continue;
+        }
+
+        fprintf(out, "%-9s %8lu %10.2f %10.2f %10.2f %10.2f\n", stage_names[stage], (unsigned long)hist.count,
+                hist.min / per_us, (float)(hist.sum / hist.count) / per_us, led_latency_p99(hist) / per_us,
+                hist.max / per_us);
+
+        for (int i = 0; i < LATENCY_BUCKETS; i++) {
+            if (hist.buckets[i]) {
+                fprintf(out, "    < %10lu cycles: %lu\n", (unsigned long)((i == 31) ? UINT32_MAX : (2u << i)),
+                        (unsigned long)hist.buckets[i]);
+            }
+        }
+    }
+
+    fprintf(out, "\n%-9s %10s %10s\n", "ledc", "written", "elided");
+    for (int kind = 0; kind < LEDC_WRITE_KIND_MAX; kind++) {
+        fprintf(out, "%-9s %10lu %10lu\n", write_names[kind], (unsigned long)writes_issued[kind],
+                (unsigned long)writes_elided[kind]);
+    }
+}
+
+void led_latency_reset(void) {
+    memset(histograms, 0, sizeof(histograms));
+    memset(writes_issued, 0, sizeof(writes_issued));
+    memset(writes_elided, 0, sizeof(writes_elided));
+}
@@ -0,0 +1,135 @@
+#include <algorithm>
+#include <led_driver.h>
+#include <led_trace.h>
+#include <helpers.hpp>
+#include <esp_timer.h>
+
+/* True if both states convert to the same channel color, only the values of the active mode count */
+static bool same_color(const led_state_t &a, const led_state_t &b){
+    if (a.mode != b.mode) {
+        return false;
+    }
+
+    switch (a.mode) {
+        case LED_COLOR_MODE_XY:          return a.x == b.x && a.y == b.y;
+        case LED_COLOR_MODE_TEMPERATURE: return a.mireds == b.mireds;
+        case LED_COLOR_MODE_HS:          return a.hue == b.hue && a.saturation == b.saturation;
+    }
+    return false;
+}
+
+/* Empty entry if there is one, the least recently used one otherwise */
+static led_cache_entry_t *cache_victim(led_cache_entry_t *cache){
+    return std::min_element(cache, cache + LED_SCENE_CACHE_SIZE,
+                            [](const led_cache_entry_t &a, const led_cache_entry_t &b) { return a.used < b.used; });
+}
+/* ----------------------------------------------------------------- */
+
+/* Puts the channel color of the staged state in nRGB if it was converted recently */
+bool LED_Driver::color_cache_lookup(){
+    for (led_cache_entry_t &entry : color_cache) {
+        if (entry.used && same_color(entry.state, state)) {
+            entry.used = ++cache_clock;
+            nRGB = entry.color;
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Remembers nRGB as the channel color of the staged state */
+void LED_Driver::color_cache_insert(){
+    led_cache_entry_t *entry = std::find_if(color_cache, color_cache + LED_SCENE_CACHE_SIZE,
+                                            [this](const led_cache_entry_t &e) { return e.used && same_color(e.state, state); });
+    if (entry == color_cache + LED_SCENE_CACHE_SIZE) {
+        entry = cache_victim(color_cache);
+    }
+    entry->used  = ++cache_clock;
+    entry->state = state;
+    entry->color = nRGB;
+}
+/* ----------------------------------------------------------------- */
+
+/* Keeps the current state and its channel color under the key, replacing a scene stored under it before */
+esp_err_t LED_Driver::store_scene(uint32_t key){
+    // The stack stores the attribute values as they are now. While a fade runs they are still stepping and the
+    // state holds the fade's target, the loop moves the hue every frame. Either way there is no one color to keep,
+    // and the entry stored under the key before is stale
+    int64_t now = esp_timer_get_time();
+    if (state.loop.active || loop_running || now < level_fade_end || now < color_fade_end) {
+        forget_scenes(key, UINT32_MAX);
+        LED_TRACE(TRACE_SCENE, 0, key, 0);
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // Staged values the next commit would convert anyway, through the color cache that costs nothing twice
+    if (color_dirty) {
+        update_color();
+    }
+
+    led_cache_entry_t *entry = std::find_if(scene_cache, scene_cache + LED_SCENE_CACHE_SIZE,
+                                            [key](const led_cache_entry_t &e) { return e.used && e.key == key; });
+    if (entry == scene_cache + LED_SCENE_CACHE_SIZE) {
+        entry = cache_victim(scene_cache);
+    }
+
+    LED_TRACE(TRACE_SCENE, 0, key, 1);
+    entry->key   = key;
+    entry->used  = ++cache_clock;
+    entry->state = state;
+    entry->color = nRGB;
+    return ESP_OK;
+}
+
+/* Stages a stored scene with its precomputed color, the next commit() fades there over the transition. The app only
+ * recalls scenes the stack will apply too, so the stack's steps towards the same values are dropped like a fade's */
+esp_err_t LED_Driver::recall_scene(uint32_t key, uint32_t transition_ms){
+    led_cache_entry_t *entry = std::find_if(scene_cache, scene_cache + LED_SCENE_CACHE_SIZE,
+                                            [key](const led_cache_entry_t &e) { return e.used && e.key == key; });
+    bool hit = (entry != scene_cache + LED_SCENE_CACHE_SIZE);
+    LED_TRACE(TRACE_SCENE, 1, key, hit);
+
+    if (!hit) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    // Ending a running loop is up to the ColorLoopActive write that comes with the scene
+    if (state.loop.active || loop_running) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    const led_state_t &scene = entry->state;
+    entry->used = ++cache_clock;
+
+    esp_err_t err = set_power(scene.power);
+    err |= fade_brightness(scene.level, transition_ms, false);
+
+    switch (scene.mode) {
+        case LED_COLOR_MODE_XY:
+            err |= fade_colorXY(scene.x, scene.y, transition_ms);
+            break;
+        case LED_COLOR_MODE_TEMPERATURE:
+            err |= fade_temperature(scene.mireds, transition_ms);
+            break;
+        case LED_COLOR_MODE_HS:
+            err |= fade_hue_saturation(scene.hue, scene.saturation, transition_ms);
+            break;
+    }
+
+    // The color is already known, commit() only scales it per channel. The late attribute writes of the same
+    // values find it in the color cache
+    nRGB = entry->color;
+    color_dirty = false;
+    color_cache_insert();
+    return err;
+}
+
+void LED_Driver::forget_scenes(uint32_t key, uint32_t mask){
+    for (led_cache_entry_t &entry : scene_cache) {
+        if (entry.used && ((entry.key ^ key) & mask) == 0) {
+            LED_TRACE(TRACE_SCENE, 2, entry.key, 0);
+            entry.used = 0;
+        }
+    }
+}
+/* ----------------------------------------------------------------- */
@@ -0,0 +1,145 @@
+#include <sdkconfig.h>
+#include <led_snapshot.h>
+#include <string.h>
+#include <stddef.h>
+#include <esp_attr.h>
+#include <esp_log.h>
+#include <esp_rom_crc.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <nvs.h>
+
+#ifndef CONFIG_LED_SNAPSHOT_NVS_DELAY_MS
+#define CONFIG_LED_SNAPSHOT_NVS_DELAY_MS 5000
+#endif
+
+static const char *TAG = "led_snapshot";
+static const char *NVS_NAMESPACE = "led_snapshot";
+static const char *NVS_KEY = "output";
+
+#define SNAPSHOT_MAGIC   0x504E534C // "LSNP"
+#define SNAPSHOT_VERSION 2          // Bumped whenever led_snapshot_t changes, older snapshots are dropped
+
+typedef struct {
+    uint32_t     magic;
+    uint32_t     version;
+    uint32_t     valid; // Slots that hold an output
+    uint32_t     layout[LED_SNAPSHOT_SLOTS]; // Fixture each slot was stored for
+    led_output_t slot[LED_SNAPSHOT_SLOTS];
+    uint32_t     crc;
+} led_snapshot_t;
+
+/* Not cleared by the startup code, on a cold boot this is noise and the CRC check sends the load to NVS */
+static RTC_NOINIT_ATTR led_snapshot_t rtc_snapshot;
+
+static led_snapshot_t     nvs_snapshot  = {}; // What NVS holds, writes that would not change it are skipped
+static bool               snapshot_ready = false;
+static esp_timer_handle_t nvs_timer     = nullptr;
+static portMUX_TYPE       snapshot_lock = portMUX_INITIALIZER_UNLOCKED; // Render task stores, the NVS timer copies
+
+static uint32_t snapshot_crc(const led_snapshot_t &snapshot) {
+    return esp_rom_crc32_le(0, (const uint8_t *)&snapshot, offsetof(led_snapshot_t, crc));
+}
+
+static bool snapshot_valid(const led_snapshot_t &snapshot) {
+    return snapshot.magic == SNAPSHOT_MAGIC && snapshot.version == SNAPSHOT_VERSION && snapshot.crc == snapshot_crc(snapshot);
+}
+
+static void snapshot_nvs_write(void *arg) {
+    led_snapshot_t copy;
+    portENTER_CRITICAL(&snapshot_lock);
+    copy = rtc_snapshot;
+    portEXIT_CRITICAL(&snapshot_lock);
+
+    if (memcmp(&copy, &nvs_snapshot, sizeof(copy)) == 0) {
+        return;
+    }
+
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (err == ESP_OK) {
+        err = nvs_set_blob(handle, NVS_KEY, &copy, sizeof(copy));
+        if (err == ESP_OK) {
+            err = nvs_commit(handle);
+        }
+        nvs_close(handle);
+    }
+
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to store the output snapshot: %s", esp_err_to_name(err));
+        return;
+    }
+    nvs_snapshot = copy;
+}
+
+/* Seeds the RTC copy from NVS on a cold boot, once. NVS must be initialized by then */
+static void snapshot_init() {
+    if (snapshot_ready) {
+        return;
+    }
+    snapshot_ready = true;
+
+    nvs_handle_t handle;
+    if (nvs_open(NVS_NAMESPACE, NVS_READONLY, &handle) == ESP_OK) {
+        size_t size = sizeof(nvs_snapshot);
+        if (nvs_get_blob(handle, NVS_KEY, &nvs_snapshot, &size) != ESP_OK || size != sizeof(nvs_snapshot) ||
+            !snapshot_valid(nvs_snapshot)) {
+            nvs_snapshot = {};
+        }
+        nvs_close(handle);
+    }
+
+    if (!snapshot_valid(rtc_snapshot)) {
+        rtc_snapshot = nvs_snapshot;
+        rtc_snapshot.magic   = SNAPSHOT_MAGIC;
+        rtc_snapshot.version = SNAPSHOT_VERSION;
+        rtc_snapshot.crc   = snapshot_crc(rtc_snapshot);
+    }
+
+    const esp_timer_create_args_t nvs_timer_args = {
+        .callback = snapshot_nvs_write,
+        .arg      = nullptr,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name     = "led_snapshot",
+        .skip_unhandled_events = true,
+    };
+    esp_timer_create(&nvs_timer_args, &nvs_timer);
+}
+/* ----------------------------------------------------------------- */
+
+esp_err_t led_snapshot_load(size_t slot, uint32_t layout, led_output_t *out) {
+    if (slot >= LED_SNAPSHOT_SLOTS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    snapshot_init();
+
+    if (!(rtc_snapshot.valid & (1u << slot)) || rtc_snapshot.layout[slot] != layout) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    *out = rtc_snapshot.slot[slot];
+    return ESP_OK;
+}
+
+void led_snapshot_store(size_t slot, uint32_t layout, const led_output_t *out) {
+    if (slot >= LED_SNAPSHOT_SLOTS) {
+        return;
+    }
+    snapshot_init();
+
+    if ((rtc_snapshot.valid & (1u << slot)) && rtc_snapshot.layout[slot] == layout &&
+        memcmp(&rtc_snapshot.slot[slot], out, sizeof(*out)) == 0) {
+        return;
+    }
+
+    portENTER_CRITICAL(&snapshot_lock);
+    rtc_snapshot.layout[slot] = layout;
+    rtc_snapshot.slot[slot] = *out;
+    rtc_snapshot.valid |= 1u << slot;
+    rtc_snapshot.crc = snapshot_crc(rtc_snapshot);
+    portEXIT_CRITICAL(&snapshot_lock);
+
+    // Every store pushes the flash write back, it only happens once the output stopped changing
+    esp_timer_stop(nvs_timer);
+    esp_timer_start_once(nvs_timer, CONFIG_LED_SNAPSHOT_NVS_DELAY_MS * 1000ULL);
+}
+/* ----------------------------------------------------------------- */
@@ -0,0 +1,319 @@
+#include <led_strip_out.h>
+#include <color_format.h>
+#include <led_trace.h>
+#include <string.h>
+#include <algorithm>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/semphr.h>
+#include <soc/soc_caps.h>
+#include <led_strip.h>
+
+static const char *TAG = "led_strip_out";
+
+typedef struct {
+    uint16_t     first;    // First pixel
+    uint16_t     count;    // Pixels
+    led_output_t from;     // Counts when the fade started
+    led_output_t to;       // Counts the fade ends at, or shown as they are
+    int64_t      start_us; // esp_timer time the fade started
+    int64_t      end_us;   // esp_timer time it ends, 0 when settled
+} led_strip_segment_t;
+
+static led_strip_segment_t segments[LED_STRIP_MAX_SEGMENTS];
+static int                 segment_count = 0;
+static portMUX_TYPE        strip_lock    = portMUX_INITIALIZER_UNLOCKED; // Render task sets, the build task reads
+static int                 batch_depth   = 0;     // Open batches, frames wait for the last one to end
+static bool                batch_pending = false; // Something was set or a frame was due while a batch was open
+
+static led_strip_handle_t strip      = nullptr;
+static uint8_t           *frame      = nullptr; // Wire order, LED_STRIP_BYTES_PER_PIXEL per pixel
+static SemaphoreHandle_t  frame_free = nullptr; // Taken while the build task writes the frame, given once led_strip has it
+static uint32_t           frame_dirty_first = CONFIG_LED_DRIVER_STRIP_LENGTH; // Pixels led_strip doesn't have yet,
+static uint32_t           frame_dirty_end   = 0;                              // guarded by frame_free like the frame
+static TaskHandle_t       build_task = nullptr;
+static TaskHandle_t       send_task  = nullptr;
+
+/* Bytes each segment's pixels currently have in the frame. Build task only */
+static uint8_t segment_pixels[LED_STRIP_MAX_SEGMENTS][LED_STRIP_BYTES_PER_PIXEL];
+
+/* Where a segment is at the time, linear between from and to while fading */
+static led_output_t segment_counts(const led_strip_segment_t &s, int64_t now, bool *fading)
+{
+    if (now >= s.end_us) {
+        return s.to;
+    }
+    if (fading) {
+        *fading = true;
+    }
+
+    int64_t span = s.end_us - s.start_us;
+    int64_t done = now - s.start_us;
+    auto lerp = [span, done](uint16_t from, uint16_t to) -> uint16_t {
+        return from + ((int64_t)to - from) * done / span;
+    };
+
+    return { lerp(s.from.red, s.to.red), lerp(s.from.green, s.to.green), lerp(s.from.blue, s.to.blue),
+             lerp(s.from.white, s.to.white), 0 };
+}
+
+/* Counts to Q15 for the pack kernels. Exact, and pack_grb_n() at full level rounds them to the same byte as
+ * (counts * 255) / 2^LED_STRIP_COUNT_BITS would */
+static q15_t count_to_q15(uint16_t counts)
+{
+    return std::min<uint32_t>(counts, 1 << LED_STRIP_COUNT_BITS) << (Q15_SHIFT - LED_STRIP_COUNT_BITS);
+}
+/* ----------------------------------------------------------------- */
+
+/* Builds a frame whenever a segment got a new target, and once per frame period while any of them fades. Only segments
+ * whose pixels changed are written, the rest of the frame still holds them from before */
+static void led_strip_build_task(void *arg)
+{
+    TickType_t wait = portMAX_DELAY;
+
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, wait);
+
+        led_strip_segment_t current[LED_STRIP_MAX_SEGMENTS];
+        portENTER_CRITICAL(&strip_lock);
+        if (batch_depth) {
+            // Half of an update is never shown, the batch end brings this frame back
+            batch_pending = true;
+            portEXIT_CRITICAL(&strip_lock);
+            wait = portMAX_DELAY;
+            continue;
+        }
+        int count = segment_count;
+        memcpy(current, segments, count * sizeof(led_strip_segment_t));
+        portEXIT_CRITICAL(&strip_lock);
+
+        int64_t now    = esp_timer_get_time();
+        bool    fading = false;
+        q15_t   red[LED_STRIP_MAX_SEGMENTS], green[LED_STRIP_MAX_SEGMENTS], blue[LED_STRIP_MAX_SEGMENTS];
+        q15_t   white[LED_STRIP_MAX_SEGMENTS];
+        for (int i = 0; i < count; i++) {
+            led_output_t counts = segment_counts(current[i], now, &fading);
+            red[i]   = count_to_q15(counts.red);
+            green[i] = count_to_q15(counts.green);
+            blue[i]  = count_to_q15(counts.blue);
+            white[i] = count_to_q15(counts.white);
+        }
+
+        // One pixel per segment, all of them in one pass
+        uint8_t pixels[LED_STRIP_MAX_SEGMENTS][LED_STRIP_BYTES_PER_PIXEL];
+#if CONFIG_LED_DRIVER_STRIP_RGBW
+        pack_grbw_n({ red, green, blue }, white, Q15_ONE, pixels[0], count);
+#else
+        pack_grb_n({ red, green, blue }, Q15_ONE, pixels[0], count);
+#endif
+
+        uint32_t changed = 0;
+        for (int i = 0; i < count; i++) {
+            if (memcmp(pixels[i], segment_pixels[i], LED_STRIP_BYTES_PER_PIXEL) != 0) {
+                changed |= 1u << i;
+            }
+        }
+
+        // A new target in between only brings the next frame forward
+        wait = fading ? std::max<TickType_t>(pdMS_TO_TICKS(1000 / CONFIG_LED_DRIVER_STRIP_FPS), 1) : portMAX_DELAY;
+        if (!changed) {
+            continue;
+        }
+
+        // Free as soon as led_strip has copied the last frame, its transfer overlaps this one being built
+        xSemaphoreTake(frame_free, portMAX_DELAY);
+        for (int i = 0; i < count; i++) {
+            if (!(changed & (1u << i))) {
+                continue;
+            }
+            uint8_t *pixel = frame + current[i].first * LED_STRIP_BYTES_PER_PIXEL;
+            for (uint16_t p = 0; p < current[i].count; p++, pixel += LED_STRIP_BYTES_PER_PIXEL) {
+                memcpy(pixel, pixels[i], LED_STRIP_BYTES_PER_PIXEL);
+            }
+            memcpy(segment_pixels[i], pixels[i], LED_STRIP_BYTES_PER_PIXEL);
+
+            frame_dirty_first = std::min<uint32_t>(frame_dirty_first, current[i].first);
+            frame_dirty_end   = std::max<uint32_t>(frame_dirty_end, current[i].first + current[i].count);
+        }
+
+        LED_TRACE(TRACE_STRIP_FRAME, fading, changed, count);
+        xTaskNotifyGive(send_task);
+    }
+}
+
+/* Copies the pixels that changed into led_strip and sends the frame. led_strip keeps its buffer between refreshes,
+ * the rest is still there from before. The refresh blocks until the transfer is through */
+static void led_strip_send_task(void *arg)
+{
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        const uint8_t *pixel = frame + frame_dirty_first * LED_STRIP_BYTES_PER_PIXEL;
+        for (uint32_t i = frame_dirty_first; i < frame_dirty_end; i++, pixel += LED_STRIP_BYTES_PER_PIXEL) {
+#if CONFIG_LED_DRIVER_STRIP_RGBW
+            led_strip_set_pixel_rgbw(strip, i, pixel[1], pixel[0], pixel[2], pixel[3]);
+#else
+            led_strip_set_pixel(strip, i, pixel[1], pixel[0], pixel[2]);
+#endif
+        }
+        frame_dirty_first = CONFIG_LED_DRIVER_STRIP_LENGTH;
+        frame_dirty_end   = 0;
+        xSemaphoreGive(frame_free);
+
+        esp_err_t err = led_strip_refresh(strip);
+        if (err != ESP_OK) {
+            ESP_LOGW(TAG, "Frame not sent: %s", esp_err_to_name(err));
+        }
+    }
+}
+/* ----------------------------------------------------------------- */
+
+esp_err_t led_strip_out_init(void)
+{
+    if (strip) {
+        return ESP_OK;
+    }
+
+    led_strip_config_t strip_config = {
+        .strip_gpio_num   = CONFIG_LED_DRIVER_STRIP_GPIO,
+        .max_leds         = CONFIG_LED_DRIVER_STRIP_LENGTH,
+#if CONFIG_LED_DRIVER_STRIP_RGBW
+        .led_pixel_format = LED_PIXEL_FORMAT_GRBW,
+        .led_model        = LED_MODEL_SK6812,
+#else
+        .led_pixel_format = LED_PIXEL_FORMAT_GRB,
+        .led_model        = LED_MODEL_WS2812,
+#endif
+        .flags            = { .invert_out = false },
+    };
+
+#if CONFIG_LED_DRIVER_STRIP_SPI
+    const led_strip_spi_config_t spi_config = {
+        .clk_src = SPI_CLK_SRC_DEFAULT,
+        .spi_bus = SPI2_HOST,
+        .flags   = { .with_dma = true },
+    };
+    esp_err_t err = led_strip_new_spi_device(&strip_config, &spi_config, &strip);
+#else
+    // Without RMT DMA (the C6 has none) the transfer is refilled from the RMT interrupt, SPI is the cheaper path there
+    const led_strip_rmt_config_t rmt_config = {
+        .clk_src           = RMT_CLK_SRC_DEFAULT,
+        .resolution_hz     = 10 * 1000 * 1000,
+        .mem_block_symbols = 0, // Driver default
+#if SOC_RMT_SUPPORT_DMA
+        .flags             = { .with_dma = true },
+#endif
+    };
+    esp_err_t err = led_strip_new_rmt_device(&strip_config, &rmt_config, &strip);
+#endif
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "No strip on GPIO %d: %s", CONFIG_LED_DRIVER_STRIP_GPIO, esp_err_to_name(err));
+        strip = nullptr;
+        return err;
+    }
+    led_strip_clear(strip);
+
+    frame      = new uint8_t[CONFIG_LED_DRIVER_STRIP_LENGTH * LED_STRIP_BYTES_PER_PIXEL]();
+    frame_free = xSemaphoreCreateBinary();
+    xSemaphoreGive(frame_free);
+
+    xTaskCreate(led_strip_build_task, "led_strip", 3072, nullptr, LED_STRIP_TASK_PRIORITY, &build_task);
+    xTaskCreate(led_strip_send_task, "led_strip_tx", 3072, nullptr, LED_STRIP_TASK_PRIORITY, &send_task);
+
+    ESP_LOGI(TAG, "%d pixels on GPIO %d", CONFIG_LED_DRIVER_STRIP_LENGTH, CONFIG_LED_DRIVER_STRIP_GPIO);
+    return ESP_OK;
+}
+
+esp_err_t led_strip_out_add_segment(uint16_t first, uint16_t count, int *segment)
+{
+    if (!segment || count == 0 || first + count > CONFIG_LED_DRIVER_STRIP_LENGTH) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (segment_count == LED_STRIP_MAX_SEGMENTS) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    esp_err_t err = led_strip_out_init();
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    portENTER_CRITICAL(&strip_lock);
+    segments[segment_count] = { first, count, {}, {}, 0, 0 };
+    *segment = segment_count++;
+    portEXIT_CRITICAL(&strip_lock);
+    return ESP_OK;
+}
+
+esp_err_t led_strip_out_set(int segment, const led_output_t *counts, uint32_t fade_ms)
+{
+    if (segment < 0 || segment >= segment_count || !counts) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    int64_t now = esp_timer_get_time();
+
+    portENTER_CRITICAL(&strip_lock);
+    led_strip_segment_t &s = segments[segment];
+    if (now < s.end_us) {
+        fade_ms = std::max<uint32_t>(fade_ms, (s.end_us - now) / 1000);
+    }
+    s.from     = segment_counts(s, now, nullptr);
+    s.to       = *counts;
+    s.start_us = now;
+    s.end_us   = (fade_ms == 0) ? 0 : now + fade_ms * 1000LL;
+    bool push  = !batch_depth;
+    batch_pending |= !push;
+    portEXIT_CRITICAL(&strip_lock);
+
+    if (push) {
+        xTaskNotifyGive(build_task);
+    }
+    return ESP_OK;
+}
+
+void led_strip_out_hold(int segment, led_output_t *out)
+{
+    if (segment < 0 || segment >= segment_count) {
+        return;
+    }
+    int64_t now = esp_timer_get_time();
+
+    portENTER_CRITICAL(&strip_lock);
+    led_strip_segment_t &s = segments[segment];
+    s.to     = segment_counts(s, now, nullptr);
+    s.end_us = 0;
+    if (out) {
+        *out = s.to;
+    }
+    bool push = !batch_depth;
+    batch_pending |= !push;
+    portEXIT_CRITICAL(&strip_lock);
+
+    if (push) {
+        xTaskNotifyGive(build_task);
+    }
+}
+
+void led_strip_out_batch_begin(void)
+{
+    portENTER_CRITICAL(&strip_lock);
+    batch_depth++;
+    portEXIT_CRITICAL(&strip_lock);
+}
+
+void led_strip_out_batch_end(void)
+{
+    portENTER_CRITICAL(&strip_lock);
+    bool push = (batch_depth > 0 && --batch_depth == 0 && batch_pending);
+    if (push) {
+        batch_pending = false;
+    }
+    portEXIT_CRITICAL(&strip_lock);
+
+    if (push && build_task) {
+        xTaskNotifyGive(build_task);
+    }
+}
+/* ----------------------------------------------------------------- */
@@ -0,0 +1,41 @@
+#include <led_trace.h>
+#include <esp_timer.h>
+#include <atomic>
+
+/* RAM ring of fixed size records. Writers from any task just claim the next slot, nothing is formatted here */
+#ifndef CONFIG_LED_TRACE_BUFFER_LEN
+#define CONFIG_LED_TRACE_BUFFER_LEN 256
+#endif
+
+static_assert((CONFIG_LED_TRACE_BUFFER_LEN & (CONFIG_LED_TRACE_BUFFER_LEN - 1)) == 0, "Trace buffer length must be a power of two");
+
+static led_trace_record_t trace_buffer[CONFIG_LED_TRACE_BUFFER_LEN];
+static std::atomic<uint32_t> trace_head = {0}; // Total records written, the slot is head % len
+
+void led_trace_write(uint16_t event, uint16_t arg0, uint32_t arg1, uint32_t arg2) {
+    uint32_t slot = trace_head.fetch_add(1, std::memory_order_relaxed) & (CONFIG_LED_TRACE_BUFFER_LEN - 1);
+
+    led_trace_record_t &record = trace_buffer[slot];
+    record.timestamp = (uint32_t)esp_timer_get_time();
+    record.event     = event;
+    record.arg0      = arg0;
+    record.arg1      = arg1;
+    record.arg2      = arg2;
+}
+
+void led_trace_dump(FILE *out) {
+    uint32_t head  = trace_head.load(std::memory_order_relaxed);
+    uint32_t count = (head < CONFIG_LED_TRACE_BUFFER_LEN) ? head : CONFIG_LED_TRACE_BUFFER_LEN;
+
+    fprintf(out, "LEDTRACE BEGIN written=%lu shown=%lu\n", (unsigned long)head, (unsigned long)count);
+    for (uint32_t i = head - count; i != head; i++) {
+        const led_trace_record_t &record = trace_buffer[i & (CONFIG_LED_TRACE_BUFFER_LEN - 1)];
+        fprintf(out, "LEDTRACE %08lx %04x %04x %08lx %08lx\n", (unsigned long)record.timestamp, record.event,
+                record.arg0, (unsigned long)record.arg1, (unsigned long)record.arg2);
+    }
+    fprintf(out, "LEDTRACE END\n");
+}
+
+void led_trace_clear(void) {
+    trace_head.store(0, std::memory_order_relaxed);
+}
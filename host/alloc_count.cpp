@@ -0,0 +1,45 @@
+#include <alloc_count.h>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+/* Replaces the global operator new/delete. The driver allocates with new only (color loop wheel), so this sees
+ * every allocation it makes */
+static std::atomic<uint64_t> allocations = {0};
+
+uint64_t alloc_count()
+{
+    return allocations.load(std::memory_order_relaxed);
+}
+
+void *operator new(std::size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *ptr = std::malloc(size ? size : 1)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    return std::malloc(size ? size : 1);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &tag) noexcept
+{
+    return operator new(size, tag);
+}
+
+void operator delete(void *ptr) noexcept                        { std::free(ptr); }
+void operator delete[](void *ptr) noexcept                      { std::free(ptr); }
+void operator delete(void *ptr, std::size_t) noexcept           { std::free(ptr); }
+void operator delete[](void *ptr, std::size_t) noexcept         { std::free(ptr); }
+void operator delete(void *ptr, const std::nothrow_t &) noexcept   { std::free(ptr); }
+void operator delete[](void *ptr, const std::nothrow_t &) noexcept { std::free(ptr); }
@@ -0,0 +1,5 @@
+#pragma once
+#include <stdint.h>
+
+/* Heap allocations made through operator new since start, counted by alloc_count.cpp */
+uint64_t alloc_count();
@@ -0,0 +1,291 @@
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <led_driver.h>
+#include <led_latency.h>
+#include <color_format.h>
+#include <cct_mix.h>
+#include <mock_ledc.h>
+#include <alloc_count.h>
+
+/* Host microbenchmarks of the color kernels and the driver entry points, against the recording LEDC mock.
+ * Usage: led_bench [name filter] [--min-ms N] [--latency]
+ * Per op: wall time, operator new calls and LEDC writes (configs, stops, duty updates, fade starts) */
+
+class LED_Driver_Bench {
+    public:
+        static uint32_t duty_to_pwm(LED_Driver &driver, uint8_t level, q15_t color) {
+            driver.bri = level;
+            return driver.duty_to_pwm(color);
+        }
+};
+
+static volatile uint32_t sink; // Results go here so the kernels are not optimized away
+
+static const char *filter   = nullptr;
+static double      min_ns   = 200e6;
+
+/* Inputs cycle through INPUTS entries, enough that a single value never stays in a cache or predictor */
+#define INPUTS 1024
+
+static uint16_t input_x[INPUTS];
+static uint16_t input_y[INPUTS];
+static uint16_t input_mireds[INPUTS];
+static uint16_t input_hue[INPUTS];
+static uint8_t  input_level[INPUTS];
+static q15_t    input_q15[INPUTS];
+
+static uint32_t xorshift(uint32_t &state) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+static void bench_inputs() {
+    uint32_t state = 0x12345678;
+    for (int i = 0; i < INPUTS; i++) {
+        // Roughly the sRGB / LED gamut, where real targets are
+        input_x[i]      = 0.15 * 65536 + xorshift(state) % (uint32_t)(0.50 * 65536);
+        input_y[i]      = 0.06 * 65536 + xorshift(state) % (uint32_t)(0.54 * 65536);
+        input_mireds[i] = 153 + xorshift(state) % (500 - 153 + 1);
+        input_hue[i]    = xorshift(state);
+        input_level[i]  = 1 + xorshift(state) % 254;
+        input_q15[i]    = xorshift(state) % (Q15_ONE + 1);
+    }
+}
+/* ----------------------------------------------------------------- */
+
+/* Runs op(i) for i = 0, 1, ... doubling the count until one batch takes min_ns, then prints the per op numbers.
+ * An op covering several pixels passes their count, the numbers are per pixel then */
+template<typename F>
+static void bench(const char *name, F &&op, uint32_t pixels = 1) {
+    if (filter && !strstr(name, filter)) {
+        return;
+    }
+
+    // Lazily built tables, the color cache and the branch predictors settle first
+    for (uint32_t i = 0; i < INPUTS; i++) {
+        op(i);
+    }
+
+    uint64_t iterations = INPUTS;
+    for (;;) {
+        uint64_t allocs = alloc_count();
+        mock_ledc_reset();
+
+        auto start = std::chrono::steady_clock::now();
+        for (uint64_t i = 0; i < iterations; i++) {
+            op((uint32_t)i);
+        }
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+        if (ns >= min_ns || iterations >= (1ull << 32)) {
+            double ops = (double)iterations * pixels;
+            printf("%-44s %12.1f %12.4f %12.4f\n", name, ns / ops,
+                   (double)(alloc_count() - allocs) / ops, (double)mock_ledc_writes() / ops);
+            return;
+        }
+        iterations *= 2;
+    }
+}
+/* ----------------------------------------------------------------- */
+
+static void bench_kernels() {
+    bench("xy_to_duty (float)", [](uint32_t i) {
+        RGB_color_t rgb;
+        xy_to_duty(input_x[i % INPUTS], input_y[i % INPUTS], 1.0f, &rgb);
+        sink = sink + (uint32_t)(rgb.red * 1000);
+    });
+
+    bench("xy_to_duty_q15", [](uint32_t i) {
+        RGB_q15_t rgb;
+        xy_to_duty_q15(input_x[i % INPUTS], input_y[i % INPUTS], &rgb);
+        sink = sink + rgb.red;
+    });
+
+    bench("xy_to_duty_lut", [](uint32_t i) {
+        RGB_q15_t rgb;
+        xy_to_duty_lut(input_x[i % INPUTS], input_y[i % INPUTS], &rgb);
+        sink = sink + rgb.red;
+    });
+
+    bench("xy_white_mix_q15", [](uint32_t i) {
+        RGB_CCT_q15_t mix;
+        xy_white_mix_q15(input_x[i % INPUTS], input_y[i % INPUTS], &mix);
+        sink = sink + mix.white;
+    });
+
+    bench("colorTemperatureToRGB (float)", [](uint32_t i) {
+        RGB_color_t rgb;
+        colorTemperatureToRGB(1000000 / input_mireds[i % INPUTS], &rgb);
+        sink = sink + (uint32_t)(rgb.red * 1000);
+    });
+
+    bench("colorTemperatureToRGB_q15", [](uint32_t i) {
+        RGB_q15_t rgb;
+        colorTemperatureToRGB_q15(1000000 / input_mireds[i % INPUTS], &rgb);
+        sink = sink + rgb.red;
+    });
+
+    bench("cct_mix_q15", [](uint32_t i) {
+        RGB_CCT_q15_t mix;
+        cct_mix_q15(input_mireds[i % INPUTS], &mix);
+        sink = sink + mix.white;
+    });
+
+    bench("hsv_to_duty_q15", [](uint32_t i) {
+        RGB_q15_t rgb;
+        hsv_to_duty_q15(input_hue[i % INPUTS], Q15_ONE, &rgb);
+        sink = sink + rgb.red;
+    });
+}
+
+/* A strip frame's worth of pixels through the batch packing, against a per pixel loop */
+#define FRAME 64
+
+static q15_t   frame_red[FRAME];
+static q15_t   frame_green[FRAME];
+static q15_t   frame_blue[FRAME];
+static q15_t   frame_white[FRAME];
+static uint8_t frame_pixels[FRAME * 4];
+
+static void bench_batches() {
+    for (int p = 0; p < FRAME; p++) {
+        frame_red[p]   = input_q15[p];
+        frame_green[p] = input_q15[p + FRAME];
+        frame_blue[p]  = input_q15[p + 2 * FRAME];
+        frame_white[p] = input_q15[p + 3 * FRAME];
+    }
+    const RGB_q15_planes_t planes = { frame_red, frame_green, frame_blue };
+
+    bench("scale_RGB_duty_q15 + pack, per pixel calls", [](uint32_t i) {
+        q15_t level = input_q15[i % INPUTS];
+        for (int p = 0; p < FRAME; p++) {
+            RGB_q15_t rgb = { frame_red[p], frame_green[p], frame_blue[p] };
+            scale_RGB_duty_q15(level, &rgb);
+            frame_pixels[3 * p + 0] = (rgb.green * 255 + Q15_ONE / 2) >> Q15_SHIFT;
+            frame_pixels[3 * p + 1] = (rgb.red   * 255 + Q15_ONE / 2) >> Q15_SHIFT;
+            frame_pixels[3 * p + 2] = (rgb.blue  * 255 + Q15_ONE / 2) >> Q15_SHIFT;
+        }
+        sink = sink + frame_pixels[0];
+    }, FRAME);
+
+    bench("pack_grb_n", [&](uint32_t i) {
+        pack_grb_n(planes, input_q15[i % INPUTS], frame_pixels, FRAME);
+        sink = sink + frame_pixels[0];
+    }, FRAME);
+
+    bench("pack_grbw_n", [&](uint32_t i) {
+        pack_grbw_n(planes, frame_white, input_q15[i % INPUTS], frame_pixels, FRAME);
+        sink = sink + frame_pixels[0];
+    }, FRAME);
+}
+/* ----------------------------------------------------------------- */
+
+static void bench_driver(LED_Driver &driver) {
+    bench("LED_Driver::duty_to_pwm", [&](uint32_t i) {
+        sink = sink + LED_Driver_Bench::duty_to_pwm(driver, input_level[i % INPUTS], input_q15[i % INPUTS]);
+    });
+
+    driver.set_power(true);
+    driver.set_brightness(200);
+    driver.commit();
+
+    bench("set_colorXY + commit, new color", [&](uint32_t i) {
+        driver.set_colorXY(input_x[i % INPUTS], input_y[i % INPUTS]);
+        driver.commit();
+    });
+
+    bench("set_colorXY + commit, same color", [&](uint32_t i) {
+        driver.set_colorXY(input_x[0], input_y[0]);
+        driver.commit();
+    });
+
+    bench("set_temperature + commit", [&](uint32_t i) {
+        driver.set_temperature(input_mireds[i % INPUTS]);
+        driver.commit();
+    });
+
+    bench("set_brightness + commit", [&](uint32_t i) {
+        driver.set_brightness(input_level[i % INPUTS]);
+        driver.commit();
+    });
+
+    bench("set_enhanced_hue + commit", [&](uint32_t i) {
+        driver.set_enhanced_hue(input_hue[i % INPUTS]);
+        driver.set_saturation(254);
+        driver.commit();
+    });
+
+    for (uint32_t key = 0; key < LED_SCENE_CACHE_SIZE; key++) {
+        driver.set_colorXY(input_x[key], input_y[key]);
+        driver.set_brightness(input_level[key]);
+        driver.commit();
+        driver.store_scene(key);
+    }
+
+    bench("recall_scene + commit", [&](uint32_t i) {
+        driver.recall_scene(i % LED_SCENE_CACHE_SIZE, 0);
+        driver.commit();
+    });
+
+    // Fades last, the ones still running would turn later instant writes into fades
+    bench("fade_colorXY + commit, 1 s", [&](uint32_t i) {
+        driver.fade_colorXY(input_x[i % INPUTS], input_y[i % INPUTS], 1000);
+        driver.commit();
+    });
+
+    driver.stop_fade();
+    driver.set_color_loop_time(1);
+    driver.set_color_loop_active(true);
+    driver.commit();
+
+    bench("color_loop_step", [&](uint32_t i) {
+        driver.color_loop_step();
+    });
+
+    driver.set_color_loop_active(false);
+    driver.commit();
+}
+/* ----------------------------------------------------------------- */
+
+int main(int argc, char **argv) {
+    bool latency = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--min-ms") == 0 && i + 1 < argc) {
+            min_ns = atof(argv[++i]) * 1e6;
+        } else if (strcmp(argv[i], "--latency") == 0) {
+            latency = true;
+        } else {
+            filter = argv[i];
+        }
+    }
+
+    bench_inputs();
+
+    LED_GPIO_MAP pins;
+    pins.red       = {1, LEDC_CHANNEL_MAX};
+    pins.green     = {2, LEDC_CHANNEL_MAX};
+    pins.blue      = {3, LEDC_CHANNEL_MAX};
+    pins.white     = {4, LEDC_CHANNEL_MAX};
+    pins.warmwhite = {5, LEDC_CHANNEL_MAX};
+    if (led_driver_assign_channels(&pins) != ESP_OK) {
+        fprintf(stderr, "No LEDC channels for the bench fixture\n");
+        return 1;
+    }
+    LED_Driver driver(pins);
+
+    printf("%-44s %12s %12s %12s\n", "benchmark", "ns/op", "allocs/op", "ledc/op");
+    bench_kernels();
+    bench_batches();
+    bench_driver(driver);
+
+    if (latency) {
+        printf("\n");
+        led_latency_dump(stdout);
+    }
+    return 0;
+}
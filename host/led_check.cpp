@@ -0,0 +1,319 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+
+#include <sdkconfig.h>
+#include <color_format.h>
+#include <cct_mix.h>
+
+/* Accuracy checks of the color kernels against their float references, registered with ctest.
+ * Usage: led_check [name filter]
+ * Each check prints its worst case and fails the run when it is over the bound the kernel documents */
+
+static const char *filter = nullptr;
+static int         failed = 0;
+
+/* Worst error of one check, with the input it happened at */
+typedef struct {
+    double   error;
+    uint32_t a;
+    uint32_t b;
+} check_worst_t;
+
+static void check_track(check_worst_t &worst, double error, uint32_t a, uint32_t b) {
+    if (error > worst.error) {
+        worst = { error, a, b };
+    }
+}
+
+static void check_report(const char *name, const check_worst_t &worst, double bound) {
+    bool ok = worst.error <= bound;
+    printf("%-44s %s  worst %.5f at (%u, %u), bound %.5f\n", name, ok ? "ok  " : "FAIL", worst.error,
+           (unsigned)worst.a, (unsigned)worst.b, bound);
+    failed += !ok;
+}
+
+static bool check_selected(const char *name) {
+    return !filter || strstr(name, filter);
+}
+
+/* Largest channel difference in full scale units */
+static double rgb_error(const RGB_color_t &ref, const RGB_q15_t &q) {
+    return std::max({ fabs(ref.red - (double)q.red / Q15_ONE), fabs(ref.green - (double)q.green / Q15_ONE),
+                      fabs(ref.blue - (double)q.blue / Q15_ONE) });
+}
+/* ----------------------------------------------------------------- */
+
+/* sRGB transfer function, as in xy_to_duty() */
+static double srgb_encode(double c) {
+    return (c > 0.0031308) ? (1.055 * pow(c, 1.0 / 2.4) - 0.055) : (12.92 * c);
+}
+
+/* Largest slope of srgb_encode(), its linear toe. Errors in linear light come out of the gamma step this much larger */
+#define SRGB_SLOPE_MAX 12.92
+
+/* Bound of the gamma table, from its sampling step alone: the largest gap between the curve and the chord over any
+ * 64 count segment, plus half a count of rounding in the entries and one count truncated by the interpolation */
+static double gamma_bound() {
+    constexpr int STEP = 64;
+    double chord = 0;
+    for (int a = 0; a < Q15_ONE; a += STEP) {
+        double fa = srgb_encode((double)a / Q15_ONE), fb = srgb_encode((double)(a + STEP) / Q15_ONE);
+        for (int k = 0; k <= STEP; k++) {
+            double lerp = fa + (fb - fa) * k / STEP;
+            chord = std::max(chord, fabs(srgb_encode((double)(a + k) / Q15_ONE) - lerp));
+        }
+    }
+    return chord + 1.5 / Q15_ONE;
+}
+
+/* Every linear Q15 value through linear_to_duty_q15() */
+static void check_gamma() {
+    const char *name = "linear_to_duty_q15 vs float";
+    if (!check_selected(name)) {
+        return;
+    }
+
+    check_worst_t worst = {};
+    for (uint32_t v = 0; v <= Q15_ONE; v++) {
+        RGB_q15_t q = { (q15_t)v, 0, 0 };
+        linear_to_duty_q15(&q);
+        check_track(worst, fabs(srgb_encode((double)v / Q15_ONE) - (double)q.red / Q15_ONE), v, 0);
+    }
+    check_report(name, worst, gamma_bound());
+}
+
+/* The Q15 and grid kernels against xy_to_duty() over the valid xy triangle. The float version only normalizes
+ * once it clips, a brightness well above ~4 makes it do that everywhere */
+#define XY_STEP 61
+
+static void check_xy() {
+    const char *names[] = { "xy_to_duty_q15 vs float", "xy_to_duty_lut vs float" };
+    check_worst_t worst[2] = {};
+    double sum = 0;
+    uint64_t points = 0;
+
+    for (uint32_t cy = 1; cy < 65536; cy += XY_STEP) {
+        for (uint32_t cx = 0; cx + cy < 65536; cx += XY_STEP) {
+            RGB_color_t ref;
+            xy_to_duty(cx, cy, 100.0f, &ref);
+
+            RGB_q15_t q;
+            xy_to_duty_q15(cx, cy, &q);
+            check_track(worst[0], rgb_error(ref, q), cx, cy);
+
+            xy_to_duty_lut(cx, cy, &q);
+            double error = rgb_error(ref, q);
+            check_track(worst[1], error, cx, cy);
+            sum += error;
+            points++;
+        }
+    }
+
+    if (check_selected(names[0])) {
+        // The Q13 matrix (coefficients within 2^-14) and the reciprocal normalization keep the linear value within
+        // 4 counts, the gamma step then adds its table error and multiplies the rest by at most its toe slope
+        check_report(names[0], worst[0], gamma_bound() + SRGB_SLOPE_MAX * 4.0 / Q15_ONE);
+    }
+    if (check_selected(names[1])) {
+        // Not a quantization bound: bilinear interpolation over the 1024 count grid can't follow the clip kink where
+        // a channel crosses zero on the gamut edges, and the toe slope magnifies that. Worst seen is 0.0234 at
+        // (20923, 22266), the bound documented on xy_to_duty_lut() rounds it up to the next thousandth
+        check_report(names[1], worst[1], 0.024);
+        // Away from the edges only the table error is left, the mean over the triangle stays within one gamma table
+        // bound of it
+        check_report("xy_to_duty_lut vs float, mean", { sum / points, 0, 0 }, gamma_bound());
+    }
+}
+
+static void check_kelvin() {
+    const char *name = "colorTemperatureToRGB_q15 vs float";
+    if (!check_selected(name)) {
+        return;
+    }
+
+    check_worst_t worst = {};
+    for (uint32_t kelvin = 0; kelvin <= 45000; kelvin++) {
+        RGB_color_t ref;
+        colorTemperatureToRGB(kelvin, &ref);
+
+        RGB_q15_t q;
+        colorTemperatureToRGB_q15(kelvin, &q);
+        check_track(worst, rgb_error(ref, q), kelvin, 0);
+    }
+    // Same double math at build time, only the table entries' rounding to Q15 and the float reference's precision
+    check_report(name, worst, 1.0 / Q15_ONE);
+}
+/* ----------------------------------------------------------------- */
+
+/* CIE 1931 xy of the Planckian locus, the same fit cct_mix.cpp places the white LEDs with */
+static void planck_xy(double kelvin, double &x, double &y) {
+    double i = 1e3 / kelvin, i2 = i * i, i3 = i2 * i;
+    x = (kelvin <= 4000) ? (-0.2661239 * i3 - 0.2343589 * i2 + 0.8776956 * i + 0.179910)
+                         : (-3.0258469 * i3 + 2.1070379 * i2 + 0.2226347 * i + 0.240390);
+    double x2 = x * x, x3 = x2 * x;
+    y = (kelvin <= 2222) ? (-1.1063814 * x3 - 1.34811020 * x2 + 2.18555832 * x - 0.20219683)
+      : (kelvin <= 4000) ? (-0.9549476 * x3 - 1.37418593 * x2 + 2.09137015 * x - 0.16748867)
+                         : ( 3.0817580 * x3 - 5.87338670 * x2 + 3.75112997 * x - 0.37001483);
+}
+
+/* Targets on the straight line between the two white LEDs are pure W/WW blends, the RGB dies stay (nearly) dark
+ * and the whites split towards the nearer end */
+static void check_white_mix() {
+    const char *name = "xy_white_mix_q15 on the W/WW line";
+    if (!check_selected(name)) {
+        return;
+    }
+
+    double wx, wy, cx, cy;
+    planck_xy(CONFIG_LED_DRIVER_WARMWHITE_CCT, wx, wy);
+    planck_xy(CONFIG_LED_DRIVER_WHITE_CCT, cx, cy);
+
+    check_worst_t worst = {};
+    uint32_t last_share = 0;
+    for (uint32_t i = 0; i <= 1024; i++) {
+        double s = i / 1024.0;
+        RGB_CCT_q15_t mix;
+        xy_white_mix_q15((wx + s * (cx - wx)) * 65535 + 0.5, (wy + s * (cy - wy)) * 65535 + 0.5, &mix);
+
+        check_track(worst, (double)std::max({ mix.red, mix.green, mix.blue }) / Q15_ONE, i, 0);
+
+        // The cool share never falls moving towards the cool LED
+        uint32_t share = ((uint64_t)mix.white << 16) / std::max(mix.white + mix.warmwhite, 1);
+        if (share + 64 < last_share) {
+            check_track(worst, 1.0, i, share);
+        }
+        last_share = share;
+    }
+    // The residual is the chroma of what the grid reads back for a point rounded to Matter counts, not exactly on
+    // the line. 0.0046 worst with the default whites, the bound leaves room for other CONFIG_LED_DRIVER_*_CCT pairs
+    check_report(name, worst, 0.01);
+}
+
+/* Linear sRGB of a chromaticity at luminance Y = 1, the way cct_mix.cpp models each white LED */
+static void white_rgb(double x, double y, double rgb[3]) {
+    static const double M[3][3] = { {  3.2404542, -1.5371385, -0.4985314 },
+                                    { -0.9692660,  1.8760108,  0.0415560 },
+                                    {  0.0556434, -0.2040259,  1.0572252 } };
+    double X = x / y, Z = (1 - x - y) / y;
+    for (int c = 0; c < 3; c++) {
+        rgb[c] = M[c][0] * X + M[c][1] + M[c][2] * Z;
+    }
+}
+
+/* Extraction only moves light between dies, it must not change the color: the residual plus what the W/WW duties
+ * stand in for has the RGB ratio xy_to_linear_lut() puts on the channels with extraction off */
+static void check_white_ratio() {
+    const char *name = "xy_white_mix_q15 ratio == xy_to_linear_lut";
+    if (!check_selected(name)) {
+        return;
+    }
+
+    double wx, wy, cx, cy, warm[3], cool[3];
+    planck_xy(CONFIG_LED_DRIVER_WARMWHITE_CCT, wx, wy);
+    planck_xy(CONFIG_LED_DRIVER_WHITE_CCT, cx, cy);
+    white_rgb(wx, wy, warm);
+    white_rgb(cx, cy, cool);
+    double peak = std::max({ warm[0], warm[1], warm[2], cool[0], cool[1], cool[2] });
+
+    check_worst_t worst = {};
+    for (uint32_t y = 1; y < 65536; y += XY_STEP * 4) {
+        for (uint32_t x = 0; x + y < 65536; x += XY_STEP * 4) {
+            RGB_q15_t lin;
+            xy_to_linear_lut(x, y, &lin);
+
+            RGB_CCT_q15_t mix;
+            xy_white_mix_q15(x, y, &mix);
+
+            const double off[3] = { (double)lin.red, (double)lin.green, (double)lin.blue };
+            const double res[3] = { (double)mix.red, (double)mix.green, (double)mix.blue };
+            double on[3];
+            for (int c = 0; c < 3; c++) {
+                on[c] = res[c] + (mix.white * cool[c] + mix.warmwhite * warm[c]) / peak;
+            }
+
+            double off_max = std::max({ off[0], off[1], off[2] });
+            double on_max  = std::max({ on[0], on[1], on[2] });
+            if (off_max == 0) {
+                check_track(worst, on_max / Q15_ONE, x, y);
+                continue;
+            }
+            for (int c = 0; c < 3; c++) {
+                check_track(worst, fabs(on[c] / on_max - off[c] / off_max), x, y);
+            }
+        }
+    }
+    // Only Q15 rounding in between: the table entries, their lerp, the subtraction and the renormalization each
+    // lose under one count, a few counts on the ratio. A transfer step on either side would be off by percents
+    check_report(name, worst, 16.0 / Q15_ONE);
+}
+/* ----------------------------------------------------------------- */
+
+/* The strip's pixel packing. Exhaustive over the counts the strip passes at full level, sampled over levels */
+static void check_pack() {
+    static q15_t   red[Q15_ONE + 1], green[Q15_ONE + 1], blue[Q15_ONE + 1], white[Q15_ONE + 1];
+    static uint8_t pixels[(Q15_ONE + 1) * 4];
+    const RGB_q15_planes_t planes = { red, green, blue };
+
+    if (check_selected("pack_grb_n == strip counts")) {
+        // led_strip_out.cpp shifts 13 bit counts up to Q15, the byte must be the rounded counts * 255 / 2^13
+        constexpr int COUNTS = 1 << 13;
+        for (uint32_t c = 0; c <= COUNTS; c++) {
+            red[c] = green[c] = blue[c] = c << 2;
+        }
+        pack_grb_n(planes, Q15_ONE, pixels, COUNTS + 1);
+
+        check_worst_t worst = {};
+        for (uint32_t c = 0; c <= COUNTS; c++) {
+            uint32_t want = (c * 255 + COUNTS / 2) / COUNTS;
+            check_track(worst, pixels[3 * c] != want || pixels[3 * c + 1] != want || pixels[3 * c + 2] != want, c, 0);
+        }
+        check_report("pack_grb_n == strip counts", worst, 0);
+    }
+
+    if (check_selected("pack_grbw_n vs float")) {
+        for (uint32_t i = 0; i <= Q15_ONE; i++) {
+            red[i]   = i;
+            green[i] = (i * 7) % (Q15_ONE + 1);
+            blue[i]  = (i * 13) % (Q15_ONE + 1);
+            white[i] = Q15_ONE - i;
+        }
+
+        check_worst_t worst = {};
+        for (uint32_t level = 0; level <= Q15_ONE; level += 1021) {
+            pack_grbw_n(planes, white, level, pixels, Q15_ONE + 1);
+            for (uint32_t i = 0; i <= Q15_ONE; i++) {
+                const q15_t in[4] = { green[i], red[i], blue[i], white[i] };
+                for (int c = 0; c < 4; c++) {
+                    double want = (double)in[c] * level / Q15_ONE / Q15_ONE * 255;
+                    check_track(worst, fabs(pixels[4 * i + c] - want), i, level);
+                }
+            }
+        }
+        // Half a step from rounding, plus the level product truncated to Q15 first: under one count, 255 / 2^15
+        // of a step
+        check_report("pack_grbw_n vs float", worst, 0.5 + 255.0 / Q15_ONE);
+    }
+}
+/* ----------------------------------------------------------------- */
+
+int main(int argc, char **argv) {
+    if (argc > 1) {
+        filter = argv[1];
+    }
+
+    check_gamma();
+    check_xy();
+    check_kelvin();
+    check_white_mix();
+    check_white_ratio();
+    check_pack();
+
+    if (failed) {
+        printf("%d check(s) failed\n", failed);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,291 @@
+#include <chrono>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include <esp_matter.h>
+#include <esp_timer.h>
+#include <freertos/task.h>
+#include <platform/CHIPDeviceLayer.h>
+#include <app_priv.h>
+#include <led_latency.h>
+#include <mock_ledc.h>
+
+using namespace chip::app::Clusters;
+
+/* Replays attribute updates recorded on the device (console `attrrec dump`) through app_driver.cpp, render task and
+ * color loop included, against the recording LEDC mock. Time is virtual and follows the recording.
+ * Usage: led_replay <recording> [--first-endpoint N] [--gap-us N] [--waveform out.csv] [--sample-ms N]
+ * Reports host throughput, the latency histograms and the LEDC writes per update; the waveform has one row per sample
+ * with the duty every channel outputs */
+
+typedef struct {
+    int64_t  time_us; // Unwrapped, the device stamps are 32 bit
+    uint16_t endpoint_id;
+    uint16_t cluster_id;
+    uint16_t attribute_id;
+    uint8_t  val_type;
+    uint32_t value;
+} replay_record_t;
+
+static const char *waveform_path  = nullptr;
+static int64_t     sample_us      = 10 * 1000;
+static int64_t     gap_us         = 2000; // Records closer than this belong to one interaction
+static uint16_t    first_endpoint = 1;    // Root is 0, the lights follow in fixture order
+
+static FILE   *waveform     = nullptr;
+static int64_t next_sample  = 0;
+static int64_t replay_start = 0;
+
+/* Lines as `attrrec dump` prints them, anything in front (log prefix, timestamps of a serial monitor) is skipped */
+static bool parse_record(const char *line, replay_record_t &record, uint32_t &stamp)
+{
+    const char *tag = strstr(line, "ATTRREC ");
+    if (!tag) {
+        return false;
+    }
+
+    unsigned endpoint, cluster, attribute, type, value;
+    if (sscanf(tag, "ATTRREC %" SCNx32 " %x %x %x %x %x", &stamp, &endpoint, &cluster, &attribute, &type, &value) != 6) {
+        return false;
+    }
+    record.endpoint_id  = endpoint;
+    record.cluster_id   = cluster;
+    record.attribute_id = attribute;
+    record.val_type     = type;
+    record.value        = value;
+    return true;
+}
+
+static bool load_records(const char *path, std::vector<replay_record_t> &records)
+{
+    FILE *in = fopen(path, "r");
+    if (!in) {
+        perror(path);
+        return false;
+    }
+
+    char     line[256];
+    uint32_t last_stamp = 0;
+    int64_t  time_us    = 0;
+    while (fgets(line, sizeof(line), in)) {
+        replay_record_t record;
+        uint32_t stamp;
+        if (!parse_record(line, record, stamp)) {
+            continue;
+        }
+
+        // Stamps wrap every ~71 minutes, the ring never spans a whole turn
+        time_us += records.empty() ? stamp : (uint32_t)(stamp - last_stamp);
+        last_stamp = stamp;
+        record.time_us = time_us;
+        records.push_back(record);
+    }
+    fclose(in);
+    return true;
+}
+/* ----------------------------------------------------------------- */
+
+static esp_matter_attr_val_t record_val(const replay_record_t &record)
+{
+    esp_matter_attr_val_t val = { (esp_matter_val_type_t)record.val_type, {} };
+    switch (val.type) {
+    case ESP_MATTER_VAL_TYPE_BOOLEAN:
+        val.val.b = record.value;
+        break;
+    case ESP_MATTER_VAL_TYPE_UINT8:
+    case ESP_MATTER_VAL_TYPE_ENUM8:
+    case ESP_MATTER_VAL_TYPE_BITMAP8:
+    case ESP_MATTER_VAL_TYPE_NULLABLE_UINT8:
+        val.val.u8 = record.value;
+        break;
+    case ESP_MATTER_VAL_TYPE_UINT16:
+    case ESP_MATTER_VAL_TYPE_ENUM16:
+    case ESP_MATTER_VAL_TYPE_BITMAP16:
+    case ESP_MATTER_VAL_TYPE_NULLABLE_UINT16:
+        val.val.u16 = record.value;
+        break;
+    default:
+        val.val.u32 = record.value;
+        break;
+    }
+    return val;
+}
+
+/* The device's app_attribute_update_cb, minus the recorder */
+static esp_err_t replay_attribute_cb(esp_matter::attribute::callback_type_t type, uint16_t endpoint_id, uint32_t cluster_id,
+                                     uint32_t attribute_id, esp_matter_attr_val_t *val, void *priv_data)
+{
+    if (type != esp_matter::attribute::PRE_UPDATE) {
+        return ESP_OK;
+    }
+    return app_driver_attribute_update((app_driver_handle_t)priv_data, endpoint_id, cluster_id, attribute_id, val);
+}
+
+/* What app_main creates the endpoints with, stored without going through the driver */
+static void seed_endpoint(uint16_t endpoint_id, light_fixture_kind_t kind)
+{
+    esp_matter_attr_val_t on_off = esp_matter_bool(DEFAULT_POWER);
+    esp_matter_attr_val_t level  = esp_matter_uint8(DEFAULT_BRIGHTNESS);
+    esp_matter_attr_val_t mode   = esp_matter_enum8((uint8_t)(kind == LIGHT_FIXTURE_CCT
+                                                              ? ColorControl::EnhancedColorMode::kColorTemperatureMireds
+                                                              : ColorControl::EnhancedColorMode::kCurrentXAndCurrentY));
+    esp_matter_attr_val_t x      = esp_matter_uint16(0x616B); // Spec defaults
+    esp_matter_attr_val_t y      = esp_matter_uint16(0x607D);
+    esp_matter_attr_val_t mireds = esp_matter_uint16(0x00FA);
+
+    mock_matter_init(nullptr);
+    esp_matter::attribute::update(endpoint_id, OnOff::Id, OnOff::Attributes::OnOff::Id, &on_off);
+    esp_matter::attribute::update(endpoint_id, LevelControl::Id, LevelControl::Attributes::CurrentLevel::Id, &level);
+    esp_matter::attribute::update(endpoint_id, ColorControl::Id, ColorControl::Attributes::EnhancedColorMode::Id, &mode);
+    esp_matter::attribute::update(endpoint_id, ColorControl::Id, ColorControl::Attributes::CurrentX::Id, &x);
+    esp_matter::attribute::update(endpoint_id, ColorControl::Id, ColorControl::Attributes::CurrentY::Id, &y);
+    esp_matter::attribute::update(endpoint_id, ColorControl::Id, ColorControl::Attributes::ColorTemperatureMireds::Id, &mireds);
+    mock_matter_init(replay_attribute_cb);
+}
+/* ----------------------------------------------------------------- */
+
+/* What the CHIP task and the render task do once an interaction is through */
+static void replay_settle()
+{
+    do {
+        mock_tasks_run();
+    } while (mock_platform_run_work());
+}
+
+static void write_sample(int64_t time_us)
+{
+    fprintf(waveform, "%.3f", (time_us - replay_start) / 1000.0);
+    for (int ch = 0; ch < LEDC_CHANNEL_MAX; ch++) {
+        fprintf(waveform, ",%" PRIu32, mock_ledc_output((ledc_channel_t)ch));
+    }
+    fprintf(waveform, "\n");
+}
+
+/* Moves virtual time to time_us: color loop frames fire and render on the way, samples are taken on the way */
+static void replay_advance(int64_t time_us)
+{
+    for (;;) {
+        int64_t due  = mock_timer_next_due();
+        int64_t next = std::min(due, waveform ? next_sample : INT64_MAX);
+        if (next > time_us) {
+            break;
+        }
+
+        mock_timer_set(next);
+        replay_settle();
+        if (waveform && next == next_sample) {
+            write_sample(next);
+            next_sample += sample_us;
+        }
+    }
+    mock_timer_set(time_us);
+}
+
+int main(int argc, char **argv)
+{
+    const char *path = nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--waveform") == 0 && i + 1 < argc) {
+            waveform_path = argv[++i];
+        } else if (strcmp(argv[i], "--sample-ms") == 0 && i + 1 < argc) {
+            sample_us = std::max(1, atoi(argv[++i])) * 1000LL;
+        } else if (strcmp(argv[i], "--gap-us") == 0 && i + 1 < argc) {
+            gap_us = atoll(argv[++i]);
+        } else if (strcmp(argv[i], "--first-endpoint") == 0 && i + 1 < argc) {
+            first_endpoint = atoi(argv[++i]);
+        } else {
+            path = argv[i];
+        }
+    }
+    if (!path) {
+        fprintf(stderr, "Usage: %s <recording> [--first-endpoint N] [--gap-us N] [--waveform out.csv] [--sample-ms N]\n",
+                argv[0]);
+        return 2;
+    }
+
+    std::vector<replay_record_t> records;
+    if (!load_records(path, records)) {
+        return 1;
+    }
+    if (records.empty()) {
+        fprintf(stderr, "No ATTRREC lines in %s\n", path);
+        return 1;
+    }
+
+    // Bring the lights up the way app_main does, then settle on the defaults before the first record
+    replay_start = records.front().time_us;
+    mock_timer_set(replay_start);
+
+    size_t fixtures = app_driver_light_fixture_count();
+    for (size_t fixture = 0; fixture < fixtures; fixture++) {
+        uint16_t endpoint_id = first_endpoint + fixture;
+        app_driver_handle_t handle = app_driver_light_init(fixture);
+        if (!handle) {
+            fprintf(stderr, "Fixture %zu failed to initialize\n", fixture);
+            return 1;
+        }
+        seed_endpoint(endpoint_id, app_driver_light_fixture_kind(fixture));
+        mock_matter_set_priv(endpoint_id, handle);
+        app_driver_light_bind(endpoint_id, handle);
+        app_driver_light_set_defaults(endpoint_id);
+    }
+    replay_settle();
+
+    if (waveform_path) {
+        waveform = fopen(waveform_path, "w");
+        if (!waveform) {
+            perror(waveform_path);
+            return 1;
+        }
+        fprintf(waveform, "ms");
+        for (int ch = 0; ch < LEDC_CHANNEL_MAX; ch++) {
+            fprintf(waveform, ",ch%d", ch);
+        }
+        fprintf(waveform, "\n");
+        next_sample = replay_start;
+    }
+
+    // Only the replay itself counts, not the bring up
+    led_latency_reset();
+    mock_ledc_reset();
+
+    size_t interactions = 0;
+    auto   start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < records.size();) {
+        replay_advance(records[i].time_us);
+        interactions++;
+
+        // One interaction: the stack writes its attributes back to back, then the render task gets to run
+        int64_t last = records[i].time_us;
+        for (; i < records.size() && records[i].time_us - last < gap_us; i++) {
+            const replay_record_t &record = records[i];
+            mock_timer_set(record.time_us);
+            last = record.time_us;
+
+            esp_matter_attr_val_t val = record_val(record);
+            esp_matter::attribute::update(record.endpoint_id, record.cluster_id, record.attribute_id, &val);
+        }
+        replay_settle();
+    }
+
+    // Let the last fades run out on the waveform
+    int64_t end_us = records.back().time_us;
+    replay_advance(waveform ? end_us + 2 * 1000 * 1000 : end_us);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if (waveform) {
+        fclose(waveform);
+    }
+
+    printf("%zu updates in %zu interactions over %.3f s recorded, replayed in %.3f s host: %.0f updates/s\n",
+           records.size(), interactions, (end_us - replay_start) / 1e6, seconds, records.size() / seconds);
+    printf("ledc writes %" PRIu32 " (%.2f per update), duty %" PRIu32 " fade %" PRIu32 " stop %" PRIu32 "\n",
+           mock_ledc_writes(), (double)mock_ledc_writes() / records.size(), mock_ledc_calls(MOCK_LEDC_DUTY),
+           mock_ledc_calls(MOCK_LEDC_FADE), mock_ledc_calls(MOCK_LEDC_STOP));
+    printf("\n");
+    led_latency_dump(stdout);
+    return 0;
+}
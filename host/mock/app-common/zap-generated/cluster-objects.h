@@ -0,0 +1,167 @@
+#pragma once
+#include <stdint.h>
+
+/* The part of the CHIP data model app_driver.cpp names: ids as in the spec, commands decode nothing. The replay only
+ * feeds attributes, command hooks are never installed on the host */
+struct CHIP_ERROR {
+    int code;
+    bool operator==(const CHIP_ERROR &other) const { return code == other.code; }
+    bool operator!=(const CHIP_ERROR &other) const { return code != other.code; }
+};
+#define CHIP_NO_ERROR CHIP_ERROR{0}
+
+namespace chip {
+
+typedef uint16_t EndpointId;
+typedef uint32_t ClusterId;
+typedef uint32_t AttributeId;
+typedef uint32_t CommandId;
+typedef uint8_t  FabricIndex;
+
+template <typename T>
+struct Optional {
+    T    value;
+    bool has_value;
+    bool HasValue() const { return has_value; }
+    const T &Value() const { return value; }
+};
+
+template <typename T>
+struct BitMask {
+    uint8_t raw;
+    uint8_t Raw() const { return raw; }
+};
+
+namespace TLV {
+struct TLVReader {
+    void Init(const TLVReader &other) {}
+};
+} // namespace TLV
+
+namespace app {
+
+struct ConcreteCommandPath {
+    EndpointId mEndpointId;
+    ClusterId  mClusterId;
+    CommandId  mCommandId;
+};
+
+namespace DataModel {
+template <typename T>
+struct Nullable {
+    T    value;
+    bool null;
+    bool IsNull() const { return null; }
+    const T &Value() const { return value; }
+};
+} // namespace DataModel
+
+namespace Clusters {
+
+#define MOCK_DECODABLE(...) struct DecodableType { __VA_ARGS__; CHIP_ERROR Decode(TLV::TLVReader &reader) { return CHIP_NO_ERROR; } }
+
+namespace OnOff {
+constexpr ClusterId Id = 0x0006;
+namespace Attributes {
+namespace OnOff { constexpr AttributeId Id = 0x0000; }
+} // namespace Attributes
+} // namespace OnOff
+
+namespace LevelControl {
+constexpr ClusterId Id = 0x0008;
+namespace Attributes {
+namespace CurrentLevel        { constexpr AttributeId Id = 0x0000; }
+namespace MinLevel            { constexpr AttributeId Id = 0x0002; }
+namespace MaxLevel            { constexpr AttributeId Id = 0x0003; }
+namespace Options             { constexpr AttributeId Id = 0x000F; }
+namespace OnOffTransitionTime { constexpr AttributeId Id = 0x0010; }
+} // namespace Attributes
+namespace Commands {
+namespace MoveToLevel          { constexpr CommandId Id = 0x00; MOCK_DECODABLE(uint8_t level; DataModel::Nullable<uint16_t> transitionTime; BitMask<uint8_t> optionsMask; BitMask<uint8_t> optionsOverride); }
+namespace Move                 { constexpr CommandId Id = 0x01; }
+namespace Step                 { constexpr CommandId Id = 0x02; }
+namespace Stop                 { constexpr CommandId Id = 0x03; }
+namespace MoveToLevelWithOnOff { constexpr CommandId Id = 0x04; MOCK_DECODABLE(uint8_t level; DataModel::Nullable<uint16_t> transitionTime; BitMask<uint8_t> optionsMask; BitMask<uint8_t> optionsOverride); }
+namespace MoveWithOnOff        { constexpr CommandId Id = 0x05; }
+namespace StepWithOnOff        { constexpr CommandId Id = 0x06; }
+namespace StopWithOnOff        { constexpr CommandId Id = 0x07; }
+} // namespace Commands
+} // namespace LevelControl
+
+namespace ColorControl {
+constexpr ClusterId Id = 0x0300;
+
+enum class EnhancedColorMode : uint8_t {
+    kCurrentHueAndCurrentSaturation         = 0,
+    kCurrentXAndCurrentY                    = 1,
+    kColorTemperatureMireds                 = 2,
+    kEnhancedCurrentHueAndCurrentSaturation = 3,
+};
+
+enum class ColorLoopDirectionEnum : uint8_t {
+    kDecrement = 0,
+    kIncrement = 1,
+};
+
+namespace Attributes {
+namespace CurrentHue                 { constexpr AttributeId Id = 0x0000; }
+namespace CurrentSaturation          { constexpr AttributeId Id = 0x0001; }
+namespace CurrentX                   { constexpr AttributeId Id = 0x0003; }
+namespace CurrentY                   { constexpr AttributeId Id = 0x0004; }
+namespace ColorTemperatureMireds     { constexpr AttributeId Id = 0x0007; }
+namespace ColorMode                  { constexpr AttributeId Id = 0x0008; }
+namespace Options                    { constexpr AttributeId Id = 0x000F; }
+namespace EnhancedCurrentHue         { constexpr AttributeId Id = 0x4000; }
+namespace EnhancedColorMode          { constexpr AttributeId Id = 0x4001; }
+namespace ColorLoopActive            { constexpr AttributeId Id = 0x4002; }
+namespace ColorLoopDirection         { constexpr AttributeId Id = 0x4003; }
+namespace ColorLoopTime              { constexpr AttributeId Id = 0x4004; }
+namespace ColorLoopStartEnhancedHue  { constexpr AttributeId Id = 0x4005; }
+namespace ColorLoopStoredEnhancedHue { constexpr AttributeId Id = 0x4006; }
+namespace ColorTempPhysicalMinMireds { constexpr AttributeId Id = 0x400B; }
+namespace ColorTempPhysicalMaxMireds { constexpr AttributeId Id = 0x400C; }
+} // namespace Attributes
+
+namespace Commands {
+namespace MoveToHue              { constexpr CommandId Id = 0x00; }
+namespace MoveHue                { constexpr CommandId Id = 0x01; }
+namespace StepHue                { constexpr CommandId Id = 0x02; }
+namespace MoveToSaturation       { constexpr CommandId Id = 0x03; }
+namespace MoveSaturation         { constexpr CommandId Id = 0x04; }
+namespace StepSaturation         { constexpr CommandId Id = 0x05; }
+namespace MoveToHueAndSaturation { constexpr CommandId Id = 0x06; }
+namespace MoveToColor            { constexpr CommandId Id = 0x07; MOCK_DECODABLE(uint16_t colorX; uint16_t colorY; uint16_t transitionTime; BitMask<uint8_t> optionsMask; BitMask<uint8_t> optionsOverride); }
+namespace MoveToColorTemperature { constexpr CommandId Id = 0x0A; MOCK_DECODABLE(uint16_t colorTemperatureMireds; uint16_t transitionTime; BitMask<uint8_t> optionsMask; BitMask<uint8_t> optionsOverride); }
+namespace MoveColor              { constexpr CommandId Id = 0x08; }
+namespace StepColor              { constexpr CommandId Id = 0x09; }
+namespace EnhancedMoveToHue      { constexpr CommandId Id = 0x40; }
+namespace EnhancedMoveHue        { constexpr CommandId Id = 0x41; }
+namespace EnhancedStepHue        { constexpr CommandId Id = 0x42; }
+namespace EnhancedMoveToHueAndSaturation { constexpr CommandId Id = 0x43; }
+namespace ColorLoopSet           { constexpr CommandId Id = 0x44; MOCK_DECODABLE(BitMask<uint8_t> updateFlags; uint8_t action; uint8_t direction; uint16_t time; uint16_t startHue; BitMask<uint8_t> optionsMask; BitMask<uint8_t> optionsOverride); }
+namespace StopMoveStep           { constexpr CommandId Id = 0x47; }
+namespace MoveColorTemperature   { constexpr CommandId Id = 0x4B; }
+namespace StepColorTemperature   { constexpr CommandId Id = 0x4C; }
+} // namespace Commands
+} // namespace ColorControl
+
+namespace ScenesManagement {
+constexpr ClusterId Id = 0x0062;
+namespace Attributes {
+namespace SceneTableSize { constexpr AttributeId Id = 0x0006; }
+} // namespace Attributes
+namespace Commands {
+namespace AddScene        { constexpr CommandId Id = 0x00; MOCK_DECODABLE(uint16_t groupID; uint8_t sceneID); }
+namespace RemoveScene     { constexpr CommandId Id = 0x02; MOCK_DECODABLE(uint16_t groupID; uint8_t sceneID); }
+namespace RemoveAllScenes { constexpr CommandId Id = 0x03; MOCK_DECODABLE(uint16_t groupID); }
+namespace StoreScene      { constexpr CommandId Id = 0x04; MOCK_DECODABLE(uint16_t groupID; uint8_t sceneID); }
+namespace RecallScene     { constexpr CommandId Id = 0x05; MOCK_DECODABLE(uint16_t groupID; uint8_t sceneID; Optional<DataModel::Nullable<uint32_t>> transitionTime); }
+namespace CopyScene       { constexpr CommandId Id = 0x40; MOCK_DECODABLE(uint8_t mode; uint16_t groupIdentifierFrom; uint8_t sceneIdentifierFrom; uint16_t groupIdentifierTo; uint8_t sceneIdentifierTo); }
+} // namespace Commands
+} // namespace ScenesManagement
+
+#undef MOCK_DECODABLE
+
+} // namespace Clusters
+} // namespace app
+} // namespace chip
@@ -0,0 +1,16 @@
+#pragma once
+#include <app-common/zap-generated/cluster-objects.h>
+#include <protocols/interaction_model/StatusCode.h>
+
+namespace chip {
+namespace app {
+
+class CommandHandler {
+    public:
+        FabricIndex GetAccessingFabricIndex() const { return 1; }
+
+        void AddStatus(const ConcreteCommandPath &path, Protocols::InteractionModel::Status status, const char *context = nullptr) {}
+};
+
+} // namespace app
+} // namespace chip
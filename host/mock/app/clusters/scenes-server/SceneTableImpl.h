@@ -0,0 +1,42 @@
+#pragma once
+#include <app-common/zap-generated/cluster-objects.h>
+
+/* The Scenes Management server's scene table as app_driver.cpp reads it. The host has no scenes, every lookup misses */
+namespace chip {
+namespace scenes {
+
+constexpr uint16_t kMaxScenesPerEndpoint = 16;
+
+struct SceneStorageId {
+    uint16_t mGroupId;
+    uint8_t  mSceneId;
+    SceneStorageId(uint8_t id, uint16_t group_id = 0) : mGroupId(group_id), mSceneId(id) {}
+};
+
+class DefaultSceneTableImpl {
+    public:
+        struct SceneTableEntry {
+            struct {
+                uint32_t mSceneTransitionTimeMs;
+            } mStorageData;
+        };
+
+        CHIP_ERROR GetSceneTableEntry(FabricIndex fabric_index, const SceneStorageId &scene_id, SceneTableEntry &entry)
+        {
+            return CHIP_ERROR{1};
+        }
+        CHIP_ERROR GetRemainingCapacity(FabricIndex fabric_index, uint8_t &capacity)
+        {
+            capacity = 0;
+            return CHIP_NO_ERROR;
+        }
+};
+
+inline DefaultSceneTableImpl *GetSceneTableImpl(EndpointId endpoint, uint16_t endpoint_table_size = kMaxScenesPerEndpoint)
+{
+    static DefaultSceneTableImpl table;
+    return &table;
+}
+
+} // namespace scenes
+} // namespace chip
@@ -0,0 +1,2 @@
+#pragma once
+/* Included by app_driver.cpp, nothing of it is used there */
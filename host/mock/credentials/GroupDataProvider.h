@@ -0,0 +1,20 @@
+#pragma once
+#include <app-common/zap-generated/cluster-objects.h>
+
+/* Group membership as app_driver.cpp asks for it, no groups on the host */
+namespace chip {
+namespace Credentials {
+
+class GroupDataProvider {
+    public:
+        bool HasEndpoint(FabricIndex fabric_index, uint16_t group_id, EndpointId endpoint_id) { return false; }
+};
+
+inline GroupDataProvider *GetGroupDataProvider()
+{
+    static GroupDataProvider provider;
+    return &provider;
+}
+
+} // namespace Credentials
+} // namespace chip
@@ -0,0 +1,15 @@
+#pragma once
+#include <stdint.h>
+#include <esp_err.h>
+
+typedef int gpio_num_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+esp_err_t gpio_set_level(gpio_num_t gpio_num, uint32_t level);
+
+#ifdef __cplusplus
+}
+#endif
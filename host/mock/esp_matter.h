@@ -0,0 +1,77 @@
+#pragma once
+#include <stdint.h>
+#include <esp_err.h>
+#include <sdkconfig.h>
+#include <app-common/zap-generated/cluster-objects.h>
+
+/* Just enough of esp_matter for app_driver.cpp. The data model is a flat table of attribute values, created on first
+ * get(). attribute::update() calls the callback set with mock_matter_init() first, like the stack's PRE_UPDATE */
+#define CHIP_DEVICE_CONFIG_ENABLE_THREAD 0
+
+typedef enum {
+    ESP_MATTER_VAL_TYPE_INVALID         = 0,
+    ESP_MATTER_VAL_TYPE_BOOLEAN         = 1,
+    ESP_MATTER_VAL_TYPE_UINT8           = 8,
+    ESP_MATTER_VAL_TYPE_UINT16          = 10,
+    ESP_MATTER_VAL_TYPE_UINT32          = 12,
+    ESP_MATTER_VAL_TYPE_ENUM8           = 15,
+    ESP_MATTER_VAL_TYPE_BITMAP8         = 16,
+    ESP_MATTER_VAL_TYPE_BITMAP16        = 17,
+    ESP_MATTER_VAL_TYPE_ENUM16          = 19,
+    ESP_MATTER_VAL_TYPE_NULLABLE_UINT8  = ESP_MATTER_VAL_TYPE_UINT8 | 0x80,
+    ESP_MATTER_VAL_TYPE_NULLABLE_UINT16 = ESP_MATTER_VAL_TYPE_UINT16 | 0x80,
+} esp_matter_val_type_t;
+
+typedef union {
+    bool     b;
+    uint8_t  u8;
+    uint16_t u16;
+    uint32_t u32;
+} esp_matter_val_t;
+
+typedef struct {
+    esp_matter_val_type_t type;
+    esp_matter_val_t      val;
+} esp_matter_attr_val_t;
+
+esp_matter_attr_val_t esp_matter_invalid(void *val);
+esp_matter_attr_val_t esp_matter_bool(bool val);
+esp_matter_attr_val_t esp_matter_uint8(uint8_t val);
+esp_matter_attr_val_t esp_matter_uint16(uint16_t val);
+esp_matter_attr_val_t esp_matter_enum8(uint8_t val);
+
+namespace esp_matter {
+
+typedef struct cluster_s   cluster_t;
+typedef struct attribute_s attribute_t;
+typedef struct command_s   command_t;
+
+enum { COMMAND_FLAG_NONE = 0x00, COMMAND_FLAG_ACCEPTED = 0x02 };
+
+namespace attribute {
+typedef enum { PRE_UPDATE, POST_UPDATE, READ, WRITE } callback_type_t;
+typedef esp_err_t (*callback_t)(callback_type_t type, uint16_t endpoint_id, uint32_t cluster_id, uint32_t attribute_id,
+                                esp_matter_attr_val_t *val, void *priv_data);
+
+attribute_t *get(uint16_t endpoint_id, uint32_t cluster_id, uint32_t attribute_id);
+esp_err_t    get_val(attribute_t *attribute, esp_matter_attr_val_t *val);
+esp_err_t    update(uint16_t endpoint_id, uint32_t cluster_id, uint32_t attribute_id, esp_matter_attr_val_t *val);
+} // namespace attribute
+
+namespace cluster {
+cluster_t *get(uint16_t endpoint_id, uint32_t cluster_id); // Always nullptr, no commands on the host
+} // namespace cluster
+
+namespace command {
+typedef esp_err_t (*callback_t)(const chip::app::ConcreteCommandPath &command_path, chip::TLV::TLVReader &tlv_data,
+                                void *opaque_ptr);
+
+command_t *get(cluster_t *cluster, uint32_t command_id, uint16_t flags);
+esp_err_t  set_user_callback(command_t *command, callback_t callback);
+} // namespace command
+
+} // namespace esp_matter
+
+/* callback gets every update() with the priv data set for the endpoint */
+void mock_matter_init(esp_matter::attribute::callback_t callback);
+void mock_matter_set_priv(uint16_t endpoint_id, void *priv_data);
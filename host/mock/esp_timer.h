@@ -0,0 +1,38 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <esp_err.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct esp_timer *esp_timer_handle_t;
+
+typedef enum { ESP_TIMER_TASK, ESP_TIMER_ISR } esp_timer_dispatch_t;
+
+typedef struct {
+    void (*callback)(void *arg);
+    void *arg;
+    esp_timer_dispatch_t dispatch_method;
+    const char *name;
+    bool skip_unhandled_events;
+} esp_timer_create_args_t;
+
+/* us since start. Runs off the host clock until mock_timer_set() switches it to virtual time */
+int64_t esp_timer_get_time(void);
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *create_args, esp_timer_handle_t *out_handle);
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us);
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period);
+esp_err_t esp_timer_stop(esp_timer_handle_t timer);
+bool      esp_timer_is_active(esp_timer_handle_t timer);
+
+/* Virtual time for replays: from the first call on, esp_timer_get_time() returns the last value set here.
+ * Time never goes back. Timers only fire from here, each at its due time, in the caller's thread */
+void    mock_timer_set(int64_t us);
+int64_t mock_timer_next_due(void); // INT64_MAX if no timer is active
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,13 @@
+#pragma once
+#include <stdint.h>
+#include <sdkconfig.h>
+
+typedef uint32_t TickType_t;
+typedef int      BaseType_t;
+typedef unsigned UBaseType_t;
+
+#define pdTRUE            1
+#define pdFALSE           0
+#define pdPASS            1
+#define portMAX_DELAY     0xFFFFFFFF
+#define pdMS_TO_TICKS(ms) (ms)
@@ -0,0 +1,23 @@
+#pragma once
+#include <freertos/FreeRTOS.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Tasks are host threads, but only run while mock_tasks_run() lets them: every task runs until it waits on its
+ * notification again with none pending. That keeps a replay deterministic, the caller decides when the render task
+ * gets to drain, the way the CHIP task hands it work after each interaction on the chip */
+typedef struct tskTaskControlBlock *TaskHandle_t;
+
+BaseType_t xTaskCreate(void (*task)(void *), const char *name, uint32_t stack_depth, void *arg, UBaseType_t priority,
+                       TaskHandle_t *created_task);
+uint32_t   ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks_to_wait);
+BaseType_t xTaskNotifyGive(TaskHandle_t task);
+void       vTaskDelay(TickType_t ticks);
+
+void mock_tasks_run(void);
+
+#ifdef __cplusplus
+}
+#endif
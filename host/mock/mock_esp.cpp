@@ -0,0 +1,144 @@
+#include <chrono>
+#include <climits>
+#include <algorithm>
+#include <esp_err.h>
+#include <esp_cpu.h>
+#include <esp_timer.h>
+#include <driver/gpio.h>
+
+static bool    timer_virtual = false;
+static int64_t timer_now_us  = 0; // Virtual time, once set
+
+static int64_t host_now_ns()
+{
+    static const auto origin = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - origin).count();
+}
+
+int64_t esp_timer_get_time(void)
+{
+    return timer_virtual ? timer_now_us : host_now_ns() / 1000;
+}
+/* ----------------------------------------------------------------- */
+
+/* esp_timer. A few slots are plenty, the app creates one timer per feature */
+struct esp_timer {
+    esp_timer_create_args_t args;
+    uint64_t period; // 0 for one shot
+    int64_t  due;
+    bool     active;
+};
+
+static constexpr int MOCK_TIMERS = 8;
+static esp_timer     timers[MOCK_TIMERS];
+static int           timer_count = 0;
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *create_args, esp_timer_handle_t *out_handle)
+{
+    if (!create_args || !out_handle || !create_args->callback) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (timer_count == MOCK_TIMERS) {
+        return ESP_ERR_NO_MEM;
+    }
+    esp_timer *timer = &timers[timer_count++];
+    *timer = { *create_args, 0, 0, false };
+    *out_handle = timer;
+    return ESP_OK;
+}
+
+static esp_err_t timer_start(esp_timer_handle_t timer, uint64_t timeout_us, uint64_t period)
+{
+    if (!timer) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (timer->active) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->period = period;
+    timer->due    = esp_timer_get_time() + timeout_us;
+    timer->active = true;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us)
+{
+    return timer_start(timer, timeout_us, 0);
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period)
+{
+    return timer_start(timer, period, period);
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer)
+{
+    if (!timer || !timer->active) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->active = false;
+    return ESP_OK;
+}
+
+bool esp_timer_is_active(esp_timer_handle_t timer)
+{
+    return timer && timer->active;
+}
+
+static esp_timer *timer_next()
+{
+    esp_timer *next = nullptr;
+    for (int i = 0; i < timer_count; i++) {
+        if (timers[i].active && (!next || timers[i].due < next->due)) {
+            next = &timers[i];
+        }
+    }
+    return next;
+}
+
+int64_t mock_timer_next_due(void)
+{
+    esp_timer *next = timer_next();
+    return next ? next->due : INT64_MAX;
+}
+
+void mock_timer_set(int64_t us)
+{
+    if (!timer_virtual) {
+        timer_virtual = true;
+        timer_now_us  = us;
+    }
+
+    // Periodic timers that fell behind fire once per period, like skip_unhandled_events = false
+    for (esp_timer *timer = timer_next(); timer && timer->due <= us; timer = timer_next()) {
+        timer_now_us  = std::max(timer_now_us, timer->due);
+        timer->active = (timer->period != 0);
+        timer->due   += timer->period;
+        timer->args.callback(timer->args.arg);
+    }
+    timer_now_us = std::max(timer_now_us, us);
+}
+
+uint32_t esp_cpu_get_cycle_count(void)
+{
+    return (uint32_t)host_now_ns();
+}
+
+const char *esp_err_to_name(esp_err_t code)
+{
+    switch (code) {
+    case ESP_OK:                return "ESP_OK";
+    case ESP_FAIL:              return "ESP_FAIL";
+    case ESP_ERR_NO_MEM:        return "ESP_ERR_NO_MEM";
+    case ESP_ERR_INVALID_ARG:   return "ESP_ERR_INVALID_ARG";
+    case ESP_ERR_INVALID_STATE: return "ESP_ERR_INVALID_STATE";
+    case ESP_ERR_NOT_FOUND:     return "ESP_ERR_NOT_FOUND";
+    case ESP_ERR_NOT_SUPPORTED: return "ESP_ERR_NOT_SUPPORTED";
+    }
+    return "UNKNOWN ERROR";
+}
+
+esp_err_t gpio_set_level(gpio_num_t gpio_num, uint32_t level)
+{
+    return ESP_OK;
+}
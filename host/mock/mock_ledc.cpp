@@ -0,0 +1,202 @@
+#include <mock_ledc.h>
+#include <esp_timer.h>
+
+typedef struct {
+    bool     configured;
+    bool     running;   // Not stopped
+    uint32_t from;      // Duty when the current fade started, or the set duty
+    uint32_t to;
+    int64_t  fade_start;
+    int64_t  fade_end;  // 0 when not fading
+    uint32_t pending;   // ledc_set_duty() value until ledc_update_duty()
+} mock_ledc_channel_t;
+
+static mock_ledc_channel_t channels[LEDC_CHANNEL_MAX];
+static uint32_t            calls[MOCK_LEDC_CALL_MAX];
+static mock_ledc_event_t   events[MOCK_LEDC_LOG_LEN];
+static uint32_t            event_count = 0;
+
+static void mock_ledc_log(mock_ledc_call_t call, int channel, uint32_t duty, uint32_t fade_ms)
+{
+    calls[call]++;
+    if (call == MOCK_LEDC_GET_DUTY) {
+        return;
+    }
+    events[event_count++ % MOCK_LEDC_LOG_LEN] = { esp_timer_get_time(), call, channel, duty, fade_ms };
+}
+
+static uint32_t mock_ledc_duty_now(const mock_ledc_channel_t &ch)
+{
+    int64_t now = esp_timer_get_time();
+    if (ch.fade_end == 0 || now >= ch.fade_end) {
+        return ch.to;
+    }
+    int64_t span = ch.fade_end - ch.fade_start;
+    return (uint32_t)(ch.from + ((int64_t)ch.to - (int64_t)ch.from) * (now - ch.fade_start) / span);
+}
+
+static bool mock_ledc_valid(ledc_channel_t channel)
+{
+    return channel >= 0 && channel < LEDC_CHANNEL_MAX;
+}
+/* ----------------------------------------------------------------- */
+
+esp_err_t ledc_timer_config(const ledc_timer_config_t *timer_conf)
+{
+    mock_ledc_log(MOCK_LEDC_TIMER_CONFIG, -1, 0, 0);
+    return timer_conf ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t ledc_channel_config(const ledc_channel_config_t *conf)
+{
+    if (!conf || !mock_ledc_valid(conf->channel)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    mock_ledc_log(MOCK_LEDC_CHANNEL_CONFIG, conf->channel, conf->duty, 0);
+    channels[conf->channel] = { true, true, conf->duty, conf->duty, 0, 0, conf->duty };
+    return ESP_OK;
+}
+
+esp_err_t ledc_stop(ledc_mode_t speed_mode, ledc_channel_t channel, uint32_t idle_level)
+{
+    if (!mock_ledc_valid(channel)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    mock_ledc_log(MOCK_LEDC_STOP, channel, 0, 0);
+    channels[channel].running  = false;
+    channels[channel].fade_end = 0;
+    return ESP_OK;
+}
+
+esp_err_t ledc_fade_func_install(int intr_alloc_flags)
+{
+    mock_ledc_log(MOCK_LEDC_FADE_INSTALL, -1, 0, 0);
+    return ESP_OK;
+}
+
+esp_err_t ledc_set_duty(ledc_mode_t speed_mode, ledc_channel_t channel, uint32_t duty)
+{
+    if (!mock_ledc_valid(channel)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    channels[channel].pending = duty; // Latched by ledc_update_duty(), logged there
+    return ESP_OK;
+}
+
+esp_err_t ledc_update_duty(ledc_mode_t speed_mode, ledc_channel_t channel)
+{
+    if (!mock_ledc_valid(channel)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    mock_ledc_channel_t &ch = channels[channel];
+    mock_ledc_log(MOCK_LEDC_DUTY, channel, ch.pending, 0);
+    ch.from = ch.to = ch.pending;
+    ch.fade_end = 0;
+    ch.running  = true;
+    return ESP_OK;
+}
+
+esp_err_t ledc_set_duty_and_update(ledc_mode_t speed_mode, ledc_channel_t channel, uint32_t duty, uint32_t hpoint)
+{
+    if (!mock_ledc_valid(channel)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    mock_ledc_channel_t &ch = channels[channel];
+    mock_ledc_log(MOCK_LEDC_DUTY, channel, duty, 0);
+    ch.from = ch.to = ch.pending = duty;
+    ch.fade_end = 0;
+    ch.running  = true;
+    return ESP_OK;
+}
+
+uint32_t ledc_get_duty(ledc_mode_t speed_mode, ledc_channel_t channel)
+{
+    if (!mock_ledc_valid(channel)) {
+        return 0;
+    }
+    mock_ledc_log(MOCK_LEDC_GET_DUTY, channel, 0, 0);
+    return mock_ledc_duty_now(channels[channel]);
+}
+
+esp_err_t ledc_set_fade_time_and_start(ledc_mode_t speed_mode, ledc_channel_t channel, uint32_t target_duty,
+                                       uint32_t max_fade_time_ms, ledc_fade_mode_t fade_mode)
+{
+    if (!mock_ledc_valid(channel)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    mock_ledc_channel_t &ch = channels[channel];
+    mock_ledc_log(MOCK_LEDC_FADE, channel, target_duty, max_fade_time_ms);
+
+    int64_t now = esp_timer_get_time();
+    ch.from       = mock_ledc_duty_now(ch);
+    ch.to         = target_duty;
+    ch.fade_start = now;
+    ch.fade_end   = (max_fade_time_ms == 0) ? 0 : now + max_fade_time_ms * 1000LL;
+    ch.running    = true;
+    return ESP_OK;
+}
+
+esp_err_t ledc_fade_stop(ledc_mode_t speed_mode, ledc_channel_t channel)
+{
+    if (!mock_ledc_valid(channel)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    mock_ledc_channel_t &ch = channels[channel];
+    mock_ledc_log(MOCK_LEDC_FADE_STOP, channel, 0, 0);
+
+    ch.from = ch.to = mock_ledc_duty_now(ch);
+    ch.fade_end = 0;
+    return ESP_OK;
+}
+/* ----------------------------------------------------------------- */
+
+uint32_t mock_ledc_calls(mock_ledc_call_t call)
+{
+    return (call < MOCK_LEDC_CALL_MAX) ? calls[call] : 0;
+}
+
+uint32_t mock_ledc_writes(void)
+{
+    uint32_t writes = 0;
+    for (int call = 0; call < MOCK_LEDC_CALL_MAX; call++) {
+        if (call != MOCK_LEDC_GET_DUTY) {
+            writes += calls[call];
+        }
+    }
+    return writes;
+}
+
+uint32_t mock_ledc_event_count(void)
+{
+    return event_count;
+}
+
+uint32_t mock_ledc_first_event(void)
+{
+    return (event_count > MOCK_LEDC_LOG_LEN) ? event_count - MOCK_LEDC_LOG_LEN : 0;
+}
+
+const mock_ledc_event_t *mock_ledc_event(uint32_t index)
+{
+    if (index < mock_ledc_first_event() || index >= event_count) {
+        return nullptr;
+    }
+    return &events[index % MOCK_LEDC_LOG_LEN];
+}
+
+uint32_t mock_ledc_output(ledc_channel_t channel)
+{
+    if (!mock_ledc_valid(channel) || !channels[channel].configured || !channels[channel].running) {
+        return 0;
+    }
+    return mock_ledc_duty_now(channels[channel]);
+}
+
+void mock_ledc_reset(void)
+{
+    for (uint32_t &count : calls) {
+        count = 0;
+    }
+    event_count = 0;
+}
+/* ----------------------------------------------------------------- */
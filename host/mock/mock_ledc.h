@@ -0,0 +1,50 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <driver/ledc.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Recording LEDC. Keeps what each channel would show, models fades linearly on esp_timer time,
+ * and logs every call so a run can be checked or counted afterwards */
+typedef enum {
+    MOCK_LEDC_TIMER_CONFIG,
+    MOCK_LEDC_CHANNEL_CONFIG,
+    MOCK_LEDC_FADE_INSTALL,
+    MOCK_LEDC_STOP,
+    MOCK_LEDC_DUTY,      // ledc_set_duty_and_update, ledc_update_duty
+    MOCK_LEDC_FADE,      // ledc_set_fade_time_and_start
+    MOCK_LEDC_FADE_STOP,
+    MOCK_LEDC_GET_DUTY,  // Reads, not counted as writes
+    MOCK_LEDC_CALL_MAX,
+} mock_ledc_call_t;
+
+typedef struct {
+    int64_t          time_us;
+    mock_ledc_call_t call;
+    int              channel; // -1 for timer/fade service calls
+    uint32_t         duty;    // Duty written, or fade target
+    uint32_t         fade_ms;
+} mock_ledc_event_t;
+
+#define MOCK_LEDC_LOG_LEN 1024 // Events kept, the oldest are overwritten
+
+uint32_t mock_ledc_calls(mock_ledc_call_t call);
+uint32_t mock_ledc_writes(void); // Every call that reaches the LEDC registers: configs, stops, duties, fades
+
+/* Events since the last reset, oldest first. index runs from mock_ledc_first_event() to mock_ledc_event_count() */
+uint32_t                 mock_ledc_event_count(void);
+uint32_t                 mock_ledc_first_event(void);
+const mock_ledc_event_t *mock_ledc_event(uint32_t index);
+
+/* Duty the channel outputs right now, 0 while stopped or not configured */
+uint32_t mock_ledc_output(ledc_channel_t channel);
+
+/* Clears the counters and the log, the channel state stays */
+void mock_ledc_reset(void);
+
+#ifdef __cplusplus
+}
+#endif
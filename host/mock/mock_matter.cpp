@@ -0,0 +1,184 @@
+#include <esp_matter.h>
+#include <platform/CHIPDeviceLayer.h>
+#include <esp_app_desc.h>
+#include <mutex>
+#include <vector>
+
+using namespace esp_matter;
+
+struct esp_matter::attribute_s {
+    uint16_t endpoint_id;
+    uint32_t cluster_id;
+    uint32_t attribute_id;
+    esp_matter_attr_val_t val;
+};
+
+/* Handles have to stay put, the driver resolves them once */
+static constexpr size_t MOCK_ATTRIBUTES = 256;
+static attribute_t matter_attributes[MOCK_ATTRIBUTES];
+static size_t      matter_attribute_count = 0;
+
+static attribute::callback_t matter_callback = nullptr;
+static void *matter_priv[CONFIG_ESP_MATTER_MAX_DYNAMIC_ENDPOINT_COUNT + 1] = {};
+
+esp_matter_attr_val_t esp_matter_invalid(void *val)
+{
+    return { ESP_MATTER_VAL_TYPE_INVALID, {} };
+}
+
+esp_matter_attr_val_t esp_matter_bool(bool val)
+{
+    esp_matter_attr_val_t attr = { ESP_MATTER_VAL_TYPE_BOOLEAN, {} };
+    attr.val.b = val;
+    return attr;
+}
+
+esp_matter_attr_val_t esp_matter_uint8(uint8_t val)
+{
+    esp_matter_attr_val_t attr = { ESP_MATTER_VAL_TYPE_UINT8, {} };
+    attr.val.u8 = val;
+    return attr;
+}
+
+esp_matter_attr_val_t esp_matter_uint16(uint16_t val)
+{
+    esp_matter_attr_val_t attr = { ESP_MATTER_VAL_TYPE_UINT16, {} };
+    attr.val.u16 = val;
+    return attr;
+}
+
+esp_matter_attr_val_t esp_matter_enum8(uint8_t val)
+{
+    esp_matter_attr_val_t attr = { ESP_MATTER_VAL_TYPE_ENUM8, {} };
+    attr.val.u8 = val;
+    return attr;
+}
+/* ----------------------------------------------------------------- */
+
+attribute_t *attribute::get(uint16_t endpoint_id, uint32_t cluster_id, uint32_t attribute_id)
+{
+    for (size_t i = 0; i < matter_attribute_count; i++) {
+        attribute_t &attr = matter_attributes[i];
+        if (attr.endpoint_id == endpoint_id && attr.cluster_id == cluster_id && attr.attribute_id == attribute_id) {
+            return &attr;
+        }
+    }
+
+    if (matter_attribute_count == MOCK_ATTRIBUTES) {
+        return nullptr;
+    }
+    attribute_t &attr = matter_attributes[matter_attribute_count++];
+    attr = { endpoint_id, cluster_id, attribute_id, esp_matter_invalid(nullptr) };
+    return &attr;
+}
+
+esp_err_t attribute::get_val(attribute_t *attribute, esp_matter_attr_val_t *val)
+{
+    if (!attribute || !val) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (attribute->val.type == ESP_MATTER_VAL_TYPE_INVALID) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    *val = attribute->val;
+    return ESP_OK;
+}
+
+esp_err_t attribute::update(uint16_t endpoint_id, uint32_t cluster_id, uint32_t attribute_id, esp_matter_attr_val_t *val)
+{
+    attribute_t *attr = get(endpoint_id, cluster_id, attribute_id);
+    if (!attr || !val) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    void *priv = (endpoint_id <= CONFIG_ESP_MATTER_MAX_DYNAMIC_ENDPOINT_COUNT) ? matter_priv[endpoint_id] : nullptr;
+    esp_err_t err = matter_callback ? matter_callback(attribute::PRE_UPDATE, endpoint_id, cluster_id, attribute_id, val, priv)
+                                    : ESP_OK;
+    if (err == ESP_OK) {
+        attr->val = *val;
+    }
+    return err;
+}
+
+cluster_t *cluster::get(uint16_t endpoint_id, uint32_t cluster_id)
+{
+    return nullptr;
+}
+
+command_t *command::get(cluster_t *cluster, uint32_t command_id, uint16_t flags)
+{
+    return nullptr;
+}
+
+esp_err_t command::set_user_callback(command_t *command, callback_t callback)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+void mock_matter_init(attribute::callback_t callback)
+{
+    matter_callback = callback;
+}
+
+void mock_matter_set_priv(uint16_t endpoint_id, void *priv_data)
+{
+    if (endpoint_id <= CONFIG_ESP_MATTER_MAX_DYNAMIC_ENDPOINT_COUNT) {
+        matter_priv[endpoint_id] = priv_data;
+    }
+}
+/* ----------------------------------------------------------------- */
+
+/* Platform manager: a work queue the replay drains between interactions, and the stack lock */
+static std::mutex platform_lock;      // Guards the queue, the render task schedules reports
+static std::mutex platform_chip_lock; // LockChipStack()
+static std::vector<std::pair<chip::DeviceLayer::PlatformManager::AsyncWorkFunct, intptr_t>> platform_work;
+
+void chip::DeviceLayer::PlatformManager::ScheduleWork(AsyncWorkFunct work, intptr_t arg)
+{
+    std::lock_guard<std::mutex> lock(platform_lock);
+    platform_work.emplace_back(work, arg);
+}
+
+void chip::DeviceLayer::PlatformManager::LockChipStack()
+{
+    platform_chip_lock.lock();
+}
+
+void chip::DeviceLayer::PlatformManager::UnlockChipStack()
+{
+    platform_chip_lock.unlock();
+}
+
+chip::DeviceLayer::PlatformManager &chip::DeviceLayer::PlatformMgr()
+{
+    static PlatformManager manager;
+    return manager;
+}
+
+int mock_platform_run_work()
+{
+    int ran = 0;
+    for (;;) {
+        std::pair<chip::DeviceLayer::PlatformManager::AsyncWorkFunct, intptr_t> item;
+        {
+            std::lock_guard<std::mutex> lock(platform_lock);
+            if (platform_work.empty()) {
+                return ran;
+            }
+            item = platform_work.front();
+            platform_work.erase(platform_work.begin());
+        }
+
+        // Work runs on the CHIP task, with the stack locked
+        std::lock_guard<std::mutex> chip_lock(platform_chip_lock);
+        item.first(item.second);
+        ran++;
+    }
+}
+/* ----------------------------------------------------------------- */
+
+const esp_app_desc_t *esp_app_get_description(void)
+{
+    static const esp_app_desc_t desc = { "host", "led_replay" };
+    return &desc;
+}
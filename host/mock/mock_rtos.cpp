@@ -0,0 +1,78 @@
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/* A task runs only between the run flag going up in mock_tasks_run() and its next wait with nothing pending */
+struct tskTaskControlBlock {
+    const char *name;
+    uint32_t    notify;  // Pending notifications
+    bool        waiting; // Parked in ulTaskNotifyTake()
+    bool        run;     // Allowed to return from ulTaskNotifyTake()
+};
+
+// Never destroyed, the parked tasks still wait on them when the process exits
+static std::mutex              &task_lock = *new std::mutex;
+static std::condition_variable &task_cv   = *new std::condition_variable;
+static std::vector<TaskHandle_t> tasks;
+static thread_local TaskHandle_t task_current = nullptr;
+
+BaseType_t xTaskCreate(void (*task)(void *), const char *name, uint32_t stack_depth, void *arg, UBaseType_t priority,
+                       TaskHandle_t *created_task)
+{
+    TaskHandle_t handle = new tskTaskControlBlock{ name, 0, false, false };
+    {
+        std::lock_guard<std::mutex> lock(task_lock);
+        tasks.push_back(handle);
+    }
+
+    // Tasks never return, the process exits with them parked
+    std::thread([task, arg, handle] {
+        task_current = handle;
+        task(arg);
+    }).detach();
+
+    if (created_task) {
+        *created_task = handle;
+    }
+    return pdPASS;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks_to_wait)
+{
+    TaskHandle_t self = task_current;
+    std::unique_lock<std::mutex> lock(task_lock);
+
+    self->waiting = true;
+    task_cv.notify_all();
+    task_cv.wait(lock, [self] { return self->run && self->notify; });
+    self->waiting = false;
+
+    uint32_t value = self->notify;
+    self->notify = clear_on_exit ? 0 : value - 1;
+    return value;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task)
+{
+    std::lock_guard<std::mutex> lock(task_lock);
+    task->notify++;
+    return pdPASS;
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+}
+
+void mock_tasks_run(void)
+{
+    std::unique_lock<std::mutex> lock(task_lock);
+    for (TaskHandle_t task : tasks) {
+        task->run = true;
+        task_cv.notify_all();
+        task_cv.wait(lock, [task] { return task->waiting && !task->notify; });
+        task->run = false;
+    }
+}
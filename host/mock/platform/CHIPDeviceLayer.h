@@ -0,0 +1,23 @@
+#pragma once
+#include <stdint.h>
+
+namespace chip {
+namespace DeviceLayer {
+
+/* Work is queued and only runs from mock_platform_run_work(), after the current "interaction" like on the CHIP task */
+class PlatformManager {
+    public:
+        typedef void (*AsyncWorkFunct)(intptr_t arg);
+
+        void ScheduleWork(AsyncWorkFunct work, intptr_t arg = 0);
+        void LockChipStack();
+        void UnlockChipStack();
+};
+
+PlatformManager &PlatformMgr();
+
+} // namespace DeviceLayer
+} // namespace chip
+
+/* Runs the queued work items, including ones they queue. Returns how many ran */
+int mock_platform_run_work();
@@ -0,0 +1,17 @@
+#pragma once
+#include <stdint.h>
+
+/* The Interaction Model statuses app_driver.cpp answers commands with */
+namespace chip {
+namespace Protocols {
+namespace InteractionModel {
+
+enum class Status : uint8_t {
+    Success        = 0x00,
+    Failure        = 0x01,
+    InvalidCommand = 0x85,
+};
+
+} // namespace InteractionModel
+} // namespace Protocols
+} // namespace chip
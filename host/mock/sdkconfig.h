@@ -0,0 +1,22 @@
+#pragma once
+/* Options for the host build, the project defaults (sdkconfig) minus what needs the chip:
+ * no dithering (gptimer ISR), no snapshot (RTC memory, NVS) and no attribute recorder (the replay is its output) */
+#define CONFIG_LED_DRIVER_DIMMING_CURVE_CIE 1
+#define CONFIG_LED_DRIVER_WHITE_CCT 6500
+#define CONFIG_LED_DRIVER_WARMWHITE_CCT 2700
+#define CONFIG_LED_DRIVER_CCT_RGB_ASSIST 1
+#define CONFIG_LED_DRIVER_WHITE_EXTRACT 1
+#define CONFIG_LED_DRIVER_DITHER 0
+#define CONFIG_LED_DRIVER_SCENE_CACHE_SIZE 8
+#define CONFIG_LED_SNAPSHOT 0
+#define CONFIG_LED_TRACE_LEVEL 1
+#define CONFIG_LED_TRACE_BUFFER_LEN 256
+#define CONFIG_LED_LATENCY_STATS 1
+
+#define CONFIG_APP_COMMIT_WINDOW_MS 0
+#define CONFIG_APP_RENDER_TASK_PRIORITY 10
+#define CONFIG_APP_RENDER_TASK_STACK_SIZE 4096
+#define CONFIG_APP_COLOR_LOOP_FRAME_MS 20
+#define CONFIG_APP_COLOR_LOOP_REPORT_MS 1000
+#define CONFIG_APP_RECORD_LEN 0
+#define CONFIG_ESP_MATTER_MAX_DYNAMIC_ENDPOINT_COUNT 16
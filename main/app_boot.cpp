@@ -0,0 +1,68 @@
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <esp_app_desc.h>
+#include <inttypes.h>
+#include <stdio.h>
+
+#include <app_priv.h>
+
+static const char *TAG = "app_boot";
+
+static const char *boot_phase_labels[BOOT_PHASE_MAX] = {
+#define APP_BOOT_PHASE_LABEL(name, label) label,
+    APP_BOOT_PHASES(APP_BOOT_PHASE_LABEL)
+#undef APP_BOOT_PHASE_LABEL
+};
+
+/* us since boot each phase was first reached, 0 is not yet. Every phase is marked from one place only */
+static int64_t boot_phase_us[BOOT_PHASE_MAX] = {};
+
+static void app_boot_log_timeline()
+{
+    char line[256];
+    int  len = snprintf(line, sizeof(line), "boot_timeline version=%s", esp_app_get_description()->version);
+
+    for (int phase = 0; phase < BOOT_PHASE_MAX && len < (int)sizeof(line); phase++) {
+        if (boot_phase_us[phase]) {
+            len += snprintf(line + len, sizeof(line) - len, " %s=%" PRId64, boot_phase_labels[phase], boot_phase_us[phase]);
+        }
+    }
+    ESP_LOGI(TAG, "%s", line);
+}
+
+void app_boot_mark(app_boot_phase_t phase)
+{
+    if (phase >= BOOT_PHASE_MAX || boot_phase_us[phase]) {
+        return;
+    }
+    boot_phase_us[phase] = esp_timer_get_time();
+
+    if (phase == BOOT_PHASE_NETWORK) {
+        app_boot_log_timeline();
+    }
+}
+
+void app_boot_dump(FILE *out)
+{
+    // First light can land anywhere, list the phases by time
+    int order[BOOT_PHASE_MAX];
+    int count = 0;
+    for (int phase = 0; phase < BOOT_PHASE_MAX; phase++) {
+        if (!boot_phase_us[phase]) {
+            continue;
+        }
+        int i = count++;
+        for (; i > 0 && boot_phase_us[order[i - 1]] > boot_phase_us[phase]; i--) {
+            order[i] = order[i - 1];
+        }
+        order[i] = phase;
+    }
+
+    int64_t last = 0;
+    fprintf(out, "%-14s %12s %12s\n", "phase", "us", "delta us");
+    for (int i = 0; i < count; i++) {
+        int64_t us = boot_phase_us[order[i]];
+        fprintf(out, "%-14s %12" PRId64 " %12" PRId64 "\n", boot_phase_labels[order[i]], us, us - last);
+        last = us;
+    }
+}
@@ -0,0 +1,126 @@
+#include <esp_log.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <esp_matter_console.h>
+#include <app_priv.h>
+
+#include <led_trace.h>
+#include <led_latency.h>
+
+static const char *TAG = "app_console";
+
+/* ledtrace [dump|clear]. The dump is meant to be piped through tools/led_trace_decode.py */
+static esp_err_t app_console_ledtrace_handler(int argc, char **argv)
+{
+    if (argc == 0 || strcmp(argv[0], "dump") == 0) {
+        led_trace_dump(stdout);
+        return ESP_OK;
+    }
+
+    if (strcmp(argv[0], "clear") == 0) {
+        led_trace_clear();
+        return ESP_OK;
+    }
+
+    ESP_LOGE(TAG, "Usage: ledtrace [dump|clear]");
+    return ESP_ERR_INVALID_ARG;
+}
+/* ---------------------------------------------------------------------------------------------------------- */
+
+/* latency [dump|reset]. Per stage histograms of the attribute -> PWM path */
+static esp_err_t app_console_latency_handler(int argc, char **argv)
+{
+    if (argc == 0 || strcmp(argv[0], "dump") == 0) {
+        led_latency_dump(stdout);
+        return ESP_OK;
+    }
+
+    if (strcmp(argv[0], "reset") == 0) {
+        led_latency_reset();
+        return ESP_OK;
+    }
+
+    ESP_LOGE(TAG, "Usage: latency [dump|reset]");
+    return ESP_ERR_INVALID_ARG;
+}
+/* ---------------------------------------------------------------------------------------------------------- */
+
+/* memory [dump|sample]. Heap and task stack watermarks, sample adds one right now */
+static esp_err_t app_console_memory_handler(int argc, char **argv)
+{
+    if (argc == 0 || strcmp(argv[0], "dump") == 0) {
+        app_memory_dump(stdout);
+        return ESP_OK;
+    }
+
+    if (strcmp(argv[0], "sample") == 0) {
+        app_memory_sample("console", nullptr);
+        app_memory_dump(stdout);
+        return ESP_OK;
+    }
+
+    ESP_LOGE(TAG, "Usage: memory [dump|sample]");
+    return ESP_ERR_INVALID_ARG;
+}
+/* ---------------------------------------------------------------------------------------------------------- */
+
+/* attrrec [dump|clear]. Recorded attribute updates, the dump is the input of host/led_replay */
+static esp_err_t app_console_attrrec_handler(int argc, char **argv)
+{
+    if (argc == 0 || strcmp(argv[0], "dump") == 0) {
+        app_record_dump(stdout);
+        return ESP_OK;
+    }
+
+    if (strcmp(argv[0], "clear") == 0) {
+        app_record_clear();
+        return ESP_OK;
+    }
+
+    ESP_LOGE(TAG, "Usage: attrrec [dump|clear]");
+    return ESP_ERR_INVALID_ARG;
+}
+/* ---------------------------------------------------------------------------------------------------------- */
+
+/* boot. Time each startup phase was reached */
+static esp_err_t app_console_boot_handler(int argc, char **argv)
+{
+    app_boot_dump(stdout);
+    return ESP_OK;
+}
+/* ---------------------------------------------------------------------------------------------------------- */
+
+
+esp_err_t app_console_register_commands()
+{
+    static const esp_matter::console::command_t commands[] = {
+        {
+            .name = "ledtrace",
+            .description = "Dump or clear the LED driver trace buffer. Usage: matter esp ledtrace [dump|clear]",
+            .handler = app_console_ledtrace_handler,
+        },
+        {
+            .name = "latency",
+            .description = "Attribute to PWM latency per stage. Usage: matter esp latency [dump|reset]",
+            .handler = app_console_latency_handler,
+        },
+        {
+            .name = "boot",
+            .description = "Boot timeline, us since boot per startup phase. Usage: matter esp boot",
+            .handler = app_console_boot_handler,
+        },
+        {
+            .name = "memory",
+            .description = "Free heap, largest block and task stack watermarks. Usage: matter esp memory [dump|sample]",
+            .handler = app_console_memory_handler,
+        },
+        {
+            .name = "attrrec",
+            .description = "Recorded attribute updates, for replay on the host. Usage: matter esp attrrec [dump|clear]",
+            .handler = app_console_attrrec_handler,
+        },
+    };
+
+    return esp_matter::console::add_commands(commands, sizeof(commands) / sizeof(commands[0]));
+}
@@ -1,158 +1,1125 @@
 #include <esp_log.h>
 #include <stdlib.h>
 #include <string.h>
+#include <inttypes.h>
+#include <atomic>
+#include <array>
+#include <algorithm>
 
 #include <esp_matter.h>
 #include <app_priv.h>
+#include <app-common/zap-generated/cluster-objects.h>
+#include <app/CommandHandler.h>
+#include <protocols/interaction_model/StatusCode.h>
+#include <app/clusters/color-control-server/color-control-server.h>
+#include <app/clusters/scenes-server/SceneTableImpl.h>
+#include <credentials/GroupDataProvider.h>
+#include <platform/CHIPDeviceLayer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <esp_timer.h>
 
 #include <led_driver.h>
+#include <led_trace.h>
+#include <led_latency.h>
 #include <button_gpio.h>
 #include <stdio.h>
+#include <spsc_ring.hpp>
 
 using namespace chip::app::Clusters;
 using namespace esp_matter;
 
 static const char *TAG = "app_driver";
 
-static LED_Driver *LED_Interface = nullptr;
-extern uint16_t light_endpoint_id;
+/* Fixtures wired to this board, each one becomes its own light endpoint. LEDC channels and timers are handed out in
+ * this order. The C6 has 6 channels and 4 timers in total, e.g. two RGB fixtures (3 + 3) or an RGB fixture and a
+ * CCT strip (3 + 2). An addressable strip (CONFIG_LED_DRIVER_STRIP) takes neither, its segments follow these */
+typedef struct {
+    light_fixture_kind_t kind;
+    LED_GPIO_MAP map;
+} light_fixture_t;
+
+static const light_fixture_t light_fixtures[] = {
+    { LIGHT_FIXTURE_COLOR, { .red = {PIN_R}, .green = {PIN_G}, .blue = {PIN_B}, .white = {PIN_W}, .warmwhite = {PIN_WW} } },
+};
+
+#define LIGHT_LEDC_FIXTURES (sizeof(light_fixtures) / sizeof(light_fixtures[0]))
+#if CONFIG_LED_DRIVER_STRIP
+#define LIGHT_STRIP_SEGMENTS CONFIG_LED_DRIVER_STRIP_SEGMENTS
+static_assert(LIGHT_STRIP_SEGMENTS <= LED_STRIP_MAX_SEGMENTS && CONFIG_LED_DRIVER_STRIP_LENGTH >= LIGHT_STRIP_SEGMENTS,
+              "Every strip segment needs a pixel and a slot in led_strip_out");
+#else
+#define LIGHT_STRIP_SEGMENTS 0
+#endif
+
+/* Fixture by index, the strip segments come after the table: equal parts, the last one takes what is left over */
+static light_fixture_t app_driver_light_fixture(size_t fixture)
+{
+#if CONFIG_LED_DRIVER_STRIP
+    if (fixture >= LIGHT_LEDC_FIXTURES) {
+        size_t   segment = fixture - LIGHT_LEDC_FIXTURES;
+        uint16_t length  = CONFIG_LED_DRIVER_STRIP_LENGTH / LIGHT_STRIP_SEGMENTS;
+        uint16_t first   = segment * length;
+        if (segment == LIGHT_STRIP_SEGMENTS - 1) {
+            length = CONFIG_LED_DRIVER_STRIP_LENGTH - first;
+        }
+        return { LIGHT_FIXTURE_COLOR, { .strip = {first, length} } };
+    }
+#endif
+    return light_fixtures[fixture];
+}
 
 /* Convert/Remap values then pass to the led driver or misc hardware interface */
-static esp_err_t app_driver_light_set_power(esp_matter_attr_val_t *val)
+static esp_err_t app_driver_light_set_power(LED_Driver *driver, esp_matter_attr_val_t *val)
 {
-    return LED_Interface->set_power(val->val.b);
+    return driver->set_power(val->val.b);
 }
 
-static esp_err_t app_driver_light_set_brightness(esp_matter_attr_val_t *val)
+static esp_err_t app_driver_light_set_brightness(LED_Driver *driver, esp_matter_attr_val_t *val)
 {
-    int value = REMAP_TO_RANGE(val->val.u8, MATTER_BRIGHTNESS, STANDARD_BRIGHTNESS);
-    return LED_Interface->set_brightness(value);
+    // The driver takes the Matter level as is, its dimming curve covers 0-254
+    return driver->set_brightness(val->val.u8);
 }
 
-static esp_err_t app_driver_light_set_temperature(esp_matter_attr_val_t *val)
+static esp_err_t app_driver_light_set_temperature(LED_Driver *driver, esp_matter_attr_val_t *val)
 {
-    uint32_t value = REMAP_TO_RANGE_INVERSE(val->val.u16, STANDARD_TEMPERATURE_FACTOR);
-    return LED_Interface->set_temperature(value);
+    // Mireds as is, the driver's mix table is indexed by them
+    return driver->set_temperature(val->val.u16);
 }
 
-static esp_err_t app_driver_light_set_y(esp_matter_attr_val_t *val)
+static esp_err_t app_driver_light_set_y(LED_Driver *driver, esp_matter_attr_val_t *val)
 {
-    ESP_LOGE(TAG, "Setting Y Color");
+    return driver->set_colorXY(-1, val->val.u16);
+}
 
-    return LED_Interface->set_colorXY(-1, val->val.u16);
+static esp_err_t app_driver_light_set_x(LED_Driver *driver, esp_matter_attr_val_t *val)
+{
+    return driver->set_colorXY(val->val.u16, -1);
 }
 
-static esp_err_t app_driver_light_set_x(esp_matter_attr_val_t *val)
+static esp_err_t app_driver_light_set_hue(LED_Driver *driver, esp_matter_attr_val_t *val)
 {
-    ESP_LOGE(TAG, "Setting X Color");
+    return driver->set_hue(val->val.u8);
+}
 
-    return LED_Interface->set_colorXY(val->val.u16, -1);
+static esp_err_t app_driver_light_set_enhanced_hue(LED_Driver *driver, esp_matter_attr_val_t *val)
+{
+    return driver->set_enhanced_hue(val->val.u16);
+}
+
+static esp_err_t app_driver_light_set_saturation(LED_Driver *driver, esp_matter_attr_val_t *val)
+{
+    return driver->set_saturation(val->val.u8);
+}
+
+static esp_err_t app_driver_light_set_loop_active(LED_Driver *driver, esp_matter_attr_val_t *val)
+{
+    return driver->set_color_loop_active(val->val.u8);
+}
+
+static esp_err_t app_driver_light_set_loop_direction(LED_Driver *driver, esp_matter_attr_val_t *val)
+{
+    return driver->set_color_loop_direction(val->val.u8 == (uint8_t)ColorControl::ColorLoopDirectionEnum::kIncrement);
+}
+
+static esp_err_t app_driver_light_set_loop_time(LED_Driver *driver, esp_matter_attr_val_t *val)
+{
+    return driver->set_color_loop_time(val->val.u16);
+}
+
+static esp_err_t app_driver_light_set_loop_start_hue(LED_Driver *driver, esp_matter_attr_val_t *val)
+{
+    return driver->set_color_loop_start_hue(val->val.u16);
 }
 /*----------------------------------------------------------------------------*/
 
 
-/* Callback that runs whenever an attribute updates. Calls the respective handler for that type of update */
-esp_err_t app_driver_attribute_update(app_driver_handle_t driver_handle, uint16_t endpoint_id, uint32_t cluster_id,
-                                      uint32_t attribute_id, esp_matter_attr_val_t *val)
+/* Attributes the light follows, one row each. color_modes are the EnhancedColorModes in which a resync applies the
+ * row, LIGHT_ATTR_ANY_MODE for rows that always apply. Rows can be in any order, the lookup table is sorted at
+ * compile time */
+#define LIGHT_ATTR_ANY_MODE 0xFF
+#define LIGHT_MODE(mode) (1u << (uint8_t)ColorControl::EnhancedColorMode::mode)
+
+typedef esp_err_t (*light_attr_apply_t)(LED_Driver *driver, esp_matter_attr_val_t *val);
+
+typedef struct {
+    uint32_t cluster_id;
+    uint32_t attribute_id;
+    uint8_t  color_modes;
+    light_attr_apply_t apply;
+} light_attr_handler_t;
+
+static constexpr light_attr_handler_t light_attr_rows[] = {
+    { OnOff::Id,        OnOff::Attributes::OnOff::Id,                         LIGHT_ATTR_ANY_MODE,
+      app_driver_light_set_power },
+    { LevelControl::Id, LevelControl::Attributes::CurrentLevel::Id,           LIGHT_ATTR_ANY_MODE,
+      app_driver_light_set_brightness },
+    { ColorControl::Id, ColorControl::Attributes::ColorTemperatureMireds::Id, LIGHT_MODE(kColorTemperatureMireds),
+      app_driver_light_set_temperature },
+    { ColorControl::Id, ColorControl::Attributes::CurrentX::Id,               LIGHT_MODE(kCurrentXAndCurrentY),
+      app_driver_light_set_x },
+    { ColorControl::Id, ColorControl::Attributes::CurrentY::Id,               LIGHT_MODE(kCurrentXAndCurrentY),
+      app_driver_light_set_y },
+    { ColorControl::Id, ColorControl::Attributes::CurrentHue::Id,             LIGHT_MODE(kCurrentHueAndCurrentSaturation),
+      app_driver_light_set_hue },
+    { ColorControl::Id, ColorControl::Attributes::EnhancedCurrentHue::Id,     LIGHT_MODE(kEnhancedCurrentHueAndCurrentSaturation),
+      app_driver_light_set_enhanced_hue },
+    { ColorControl::Id, ColorControl::Attributes::CurrentSaturation::Id,
+      LIGHT_MODE(kCurrentHueAndCurrentSaturation) | LIGHT_MODE(kEnhancedCurrentHueAndCurrentSaturation),
+      app_driver_light_set_saturation },
+    { ColorControl::Id, ColorControl::Attributes::ColorLoopActive::Id,        LIGHT_ATTR_ANY_MODE,
+      app_driver_light_set_loop_active },
+    { ColorControl::Id, ColorControl::Attributes::ColorLoopDirection::Id,     LIGHT_ATTR_ANY_MODE,
+      app_driver_light_set_loop_direction },
+    { ColorControl::Id, ColorControl::Attributes::ColorLoopTime::Id,          LIGHT_ATTR_ANY_MODE,
+      app_driver_light_set_loop_time },
+    { ColorControl::Id, ColorControl::Attributes::ColorLoopStartEnhancedHue::Id, LIGHT_ATTR_ANY_MODE,
+      app_driver_light_set_loop_start_hue },
+};
+
+#define LIGHT_ATTR_COUNT (sizeof(light_attr_rows) / sizeof(light_attr_rows[0]))
+static_assert(LIGHT_ATTR_COUNT < UINT8_MAX, "Queued commands carry the row index in a uint8_t");
+
+static constexpr bool light_attr_less(const light_attr_handler_t &a, const light_attr_handler_t &b)
 {
-    esp_err_t err = ESP_OK;
-    if (endpoint_id == light_endpoint_id) {
-        led_driver_handle_t handle = (led_driver_handle_t)driver_handle;
-       
-        if (cluster_id == OnOff::Id) {
-            if (attribute_id == OnOff::Attributes::OnOff::Id) {
-                err = app_driver_light_set_power(val);
+    return (a.cluster_id != b.cluster_id) ? (a.cluster_id < b.cluster_id) : (a.attribute_id < b.attribute_id);
+}
+
+static constexpr std::array<light_attr_handler_t, LIGHT_ATTR_COUNT> light_attr_table = [] {
+    std::array<light_attr_handler_t, LIGHT_ATTR_COUNT> table = {};
+    std::copy(std::begin(light_attr_rows), std::end(light_attr_rows), table.begin());
+    std::sort(table.begin(), table.end(), light_attr_less);
+    return table;
+}();
+
+static_assert(std::adjacent_find(light_attr_table.begin(), light_attr_table.end(),
+                                 [](const light_attr_handler_t &a, const light_attr_handler_t &b) {
+                                     return !light_attr_less(a, b);
+                                 }) == light_attr_table.end(),
+              "Attribute listed twice");
+
+/* Binary search for the row of an attribute, LIGHT_ATTR_COUNT if the light ignores it */
+static uint8_t app_driver_light_find_attr(uint32_t cluster_id, uint32_t attribute_id)
+{
+    light_attr_handler_t key = { cluster_id, attribute_id, 0, nullptr };
+    auto it = std::lower_bound(light_attr_table.begin(), light_attr_table.end(), key, light_attr_less);
+
+    if (it == light_attr_table.end() || it->cluster_id != cluster_id || it->attribute_id != attribute_id) {
+        return LIGHT_ATTR_COUNT;
+    }
+    return it - light_attr_table.begin();
+}
+/*----------------------------------------------------------------------------*/
+
+
+/* Endpoint id -> driver and its attribute handles, resolved once when the endpoint is bound.
+ * Endpoint ids are handed out sequentially, so a flat table is enough */
+#define LIGHT_MAX_ENDPOINTS CONFIG_ESP_MATTER_MAX_DYNAMIC_ENDPOINT_COUNT
+static_assert(LIGHT_MAX_ENDPOINTS <= 32, "Resync mask holds one bit per endpoint");
+
+typedef struct {
+    LED_Driver  *driver;                       // Only touched by the render task once it is running
+    attribute_t *color_mode;                   // EnhancedColorMode, decides which color rows a resync applies
+    attribute_t *attributes[LIGHT_ATTR_COUNT]; // Per light_attr_table row, nullptr if the endpoint doesn't have it
+    int64_t      loop_reported_us;             // Last time the color loop hue went back to the data model
+} light_endpoint_t;
+
+static light_endpoint_t light_endpoints[LIGHT_MAX_ENDPOINTS] = {};
+
+static LED_Driver *app_driver_light_get(uint16_t endpoint_id)
+{
+    return (endpoint_id < LIGHT_MAX_ENDPOINTS) ? light_endpoints[endpoint_id].driver : nullptr;
+}
+/*----------------------------------------------------------------------------*/
+
+
+/* Render queue. The Matter callbacks only copy what changed into a fixed size command and return, the render task
+ * owns LED_Driver and does all color math and LEDC writes. The CHIP thread is the only producer */
+typedef enum : uint8_t {
+    LIGHT_CMD_ATTRIBUTE,        // Attribute write, cluster/attribute/val
+    LIGHT_CMD_FADE_LEVEL,       // target[0] = level, turn_on for the *WithOnOff commands
+    LIGHT_CMD_FADE_XY,          // target[0] = x, target[1] = y
+    LIGHT_CMD_FADE_TEMPERATURE, // target[0] = mireds
+    LIGHT_CMD_STOP_FADE,
+    LIGHT_CMD_STORE_SCENE,      // target[0] = group, target[1] = fabric << 8 | scene
+    LIGHT_CMD_RECALL_SCENE,     // Same key as store
+    LIGHT_CMD_FORGET_SCENE,     // Same key as store, the stack added, removed or overwrote that scene
+    LIGHT_CMD_FORGET_GROUP,     // Same key, every scene of the group on that fabric
+    LIGHT_CMD_FORGET_ALL,       // Every cached scene, a fabric went away
+} light_cmd_type_t;
+
+typedef struct {
+    light_cmd_type_t type;
+    bool     turn_on;
+    uint8_t  attribute; // light_attr_table row
+    uint16_t endpoint_id;
+    esp_matter_attr_val_t val;
+    uint16_t target[2];
+    uint32_t transition_ms;
+    uint32_t posted; // Cycle count when the change came in, for the latency stats
+} light_cmd_t;
+
+#define LIGHT_QUEUE_LEN 32
+
+static SPSC_Ring<light_cmd_t, LIGHT_QUEUE_LEN> light_queue;
+static TaskHandle_t render_task = nullptr;
+
+// Endpoints to re-read from the data model, set when the queue overflowed or the defaults were requested
+static std::atomic<uint32_t> resync_pending = {0};
+#define RESYNC_ALL UINT32_MAX
+static bool flush_pending = false; // CHIP thread only
+
+static void app_driver_flush_work(intptr_t arg)
+{
+    flush_pending = false;
+    xTaskNotifyGive(render_task);
+}
+
+/* Wakes the render task once for everything queued in the current interaction */
+static void app_driver_request_render()
+{
+#if CONFIG_APP_COMMIT_WINDOW_MS > 0
+    // The render task waits out the window itself
+    xTaskNotifyGive(render_task);
+#else
+    if (flush_pending) {
+        return;
+    }
+    flush_pending = true;
+
+    // Queued behind the work item that is processing the current interaction
+    chip::DeviceLayer::PlatformMgr().ScheduleWork(app_driver_flush_work, 0);
+#endif
+}
+
+static void app_driver_post(const light_cmd_t &cmd)
+{
+    if (!light_queue.push(cmd)) {
+        // Never block the CHIP thread, the render task picks the state up from the data model instead
+        LED_TRACE(TRACE_APP_QUEUE_FULL, 0, 0, 0);
+        resync_pending = RESYNC_ALL;
+    }
+    app_driver_request_render();
+}
+/*----------------------------------------------------------------------------*/
+
+
+/* Command hooks. These run before the Matter stack handles the command, so the driver gets the final target and
+ * TransitionTime and can hand the whole transition to the LEDC fader instead of following the stack's steps */
+static uint32_t transition_to_ms(uint16_t transition_time)
+{
+    return transition_time * 100; // TransitionTime is in tenths of a second
+}
+
+/* An attribute of the endpoint as a plain number, fallback if the endpoint doesn't have it */
+static uint32_t app_driver_read_attr(uint16_t endpoint_id, uint32_t cluster_id, uint32_t attribute_id, uint32_t fallback)
+{
+    attribute_t *attr = attribute::get(endpoint_id, cluster_id, attribute_id);
+    esp_matter_attr_val_t val = {};
+    if (!attr || attribute::get_val(attr, &val) != ESP_OK) {
+        return fallback;
+    }
+
+    switch (val.type) {
+    case ESP_MATTER_VAL_TYPE_BOOLEAN: return val.val.b;
+    case ESP_MATTER_VAL_TYPE_UINT8:
+    case ESP_MATTER_VAL_TYPE_ENUM8:
+    case ESP_MATTER_VAL_TYPE_BITMAP8:  return val.val.u8;
+    case ESP_MATTER_VAL_TYPE_UINT16:   return val.val.u16;
+    default:                           return fallback;
+    }
+}
+
+/* The servers' acceptance rule for commands that don't turn the light on: while it is off they run only with the
+ * effective ExecuteIfOff option, the command's override where its mask is set and the cluster's Options elsewhere.
+ * A command the stack ignores must not move the driver either, the next On would show a value no attribute had */
+static bool app_driver_light_executes(uint16_t endpoint_id, uint32_t cluster_id, uint8_t options_mask, uint8_t options_override)
+{
+    if (app_driver_read_attr(endpoint_id, OnOff::Id, OnOff::Attributes::OnOff::Id, true)) {
+        return true;
+    }
+
+    constexpr uint8_t EXECUTE_IF_OFF = 0x01; // Bit 0 of both clusters' OptionsBitmap
+    uint8_t options = app_driver_read_attr(endpoint_id, cluster_id, LevelControl::Attributes::Options::Id, 0);
+    return ((options_mask & options_override) | (~options_mask & options)) & EXECUTE_IF_OFF;
+}
+
+/* Writes a number into an attribute of the endpoint in the type it is stored as, nothing if the endpoint doesn't have
+ * it. Goes through the attribute callback like any other update, so the driver follows */
+static void app_driver_write_attr(uint16_t endpoint_id, uint32_t cluster_id, uint32_t attribute_id, uint32_t value)
+{
+    attribute_t *attr = attribute::get(endpoint_id, cluster_id, attribute_id);
+    esp_matter_attr_val_t val = {};
+    if (!attr || attribute::get_val(attr, &val) != ESP_OK) {
+        return;
+    }
+
+    switch (val.type) {
+    case ESP_MATTER_VAL_TYPE_BOOLEAN: val.val.b   = value; break;
+    case ESP_MATTER_VAL_TYPE_UINT8:
+    case ESP_MATTER_VAL_TYPE_ENUM8:
+    case ESP_MATTER_VAL_TYPE_BITMAP8:  val.val.u8  = value; break;
+    case ESP_MATTER_VAL_TYPE_UINT16:   val.val.u16 = value; break;
+    default:                           return;
+    }
+    attribute::update(endpoint_id, cluster_id, attribute_id, &val);
+}
+
+/* ColorLoopSet, answered here instead of by the Color Control server. The server would run a loop of its own off a
+ * 100 ms timer and write EnhancedCurrentHue on every step, next to the driver's loop and its throttled reports.
+ * Same attribute rules as the server: the update flags in order, the hue stored on activation and written back on
+ * deactivation, the switch to enhanced HS. Only its timer never starts. True once the command has its status, the
+ * hook then keeps the server's handler from running at all */
+static bool app_driver_color_loop_set(const chip::app::ConcreteCommandPath &command_path,
+                                      const ColorControl::Commands::ColorLoopSet::DecodableType &data, void *opaque_ptr)
+{
+    using chip::Protocols::InteractionModel::Status;
+    auto *handler = static_cast<chip::app::CommandHandler *>(opaque_ptr);
+    uint16_t endpoint_id = command_path.mEndpointId;
+    if (!handler || !app_driver_light_get(endpoint_id)) {
+        return false;
+    }
+
+    constexpr uint8_t UPDATE_ACTION    = 0x01; // UpdateFlagsBitmap
+    constexpr uint8_t UPDATE_DIRECTION = 0x02;
+    constexpr uint8_t UPDATE_TIME      = 0x04;
+    constexpr uint8_t UPDATE_START_HUE = 0x08;
+    constexpr uint8_t ACTION_DEACTIVATE = 0;   // ColorLoopActionEnum, 1 and 2 activate
+    constexpr uint8_t ACTION_MAX        = 2;
+
+    uint8_t flags     = data.updateFlags.Raw();
+    uint8_t action    = static_cast<uint8_t>(data.action);
+    uint8_t direction = static_cast<uint8_t>(data.direction);
+    if (action > ACTION_MAX || direction > (uint8_t)ColorControl::ColorLoopDirectionEnum::kIncrement) {
+        handler->AddStatus(command_path, Status::InvalidCommand);
+        return true;
+    }
+    // Ignored while off without ExecuteIfOff, still a success
+    if (!app_driver_light_executes(endpoint_id, ColorControl::Id, data.optionsMask.Raw(), data.optionsOverride.Raw())) {
+        handler->AddStatus(command_path, Status::Success);
+        return true;
+    }
+
+    if (flags & UPDATE_DIRECTION) {
+        app_driver_write_attr(endpoint_id, ColorControl::Id, ColorControl::Attributes::ColorLoopDirection::Id, direction);
+    }
+    if (flags & UPDATE_TIME) {
+        app_driver_write_attr(endpoint_id, ColorControl::Id, ColorControl::Attributes::ColorLoopTime::Id, data.time);
+    }
+    if (flags & UPDATE_START_HUE) {
+        app_driver_write_attr(endpoint_id, ColorControl::Id, ColorControl::Attributes::ColorLoopStartEnhancedHue::Id, data.startHue);
+    }
+
+    bool active = app_driver_read_attr(endpoint_id, ColorControl::Id, ColorControl::Attributes::ColorLoopActive::Id, false);
+    if ((flags & UPDATE_ACTION) && action == ACTION_DEACTIVATE && active) {
+        // The driver freezes the loop on the first write, the stored hue follows it like the server's own stop
+        ColorControlServer::Instance().stopAllColorTransitions(endpoint_id);
+        app_driver_write_attr(endpoint_id, ColorControl::Id, ColorControl::Attributes::ColorLoopActive::Id, false);
+
+        uint16_t stored = app_driver_read_attr(endpoint_id, ColorControl::Id,
+                                               ColorControl::Attributes::ColorLoopStoredEnhancedHue::Id, 0);
+        app_driver_write_attr(endpoint_id, ColorControl::Id, ColorControl::Attributes::EnhancedCurrentHue::Id, stored);
+        app_driver_write_attr(endpoint_id, ColorControl::Id, ColorControl::Attributes::CurrentHue::Id, stored >> 8);
+    }
+    else if ((flags & UPDATE_ACTION) && action != ACTION_DEACTIVATE) {
+        // Hue moves the server is still stepping end here, its loop would have taken their hue over
+        ColorControlServer::Instance().stopAllColorTransitions(endpoint_id);
+
+        uint16_t hue = app_driver_read_attr(endpoint_id, ColorControl::Id, ColorControl::Attributes::EnhancedCurrentHue::Id, 0);
+        app_driver_write_attr(endpoint_id, ColorControl::Id, ColorControl::Attributes::ColorLoopStoredEnhancedHue::Id, hue);
+        app_driver_write_attr(endpoint_id, ColorControl::Id, ColorControl::Attributes::ColorLoopActive::Id, true);
+        app_driver_write_attr(endpoint_id, ColorControl::Id, ColorControl::Attributes::ColorMode::Id,
+                              (uint8_t)ColorControl::EnhancedColorMode::kCurrentHueAndCurrentSaturation);
+        app_driver_write_attr(endpoint_id, ColorControl::Id, ColorControl::Attributes::EnhancedColorMode::Id,
+                              (uint8_t)ColorControl::EnhancedColorMode::kEnhancedCurrentHueAndCurrentSaturation);
+    }
+
+    handler->AddStatus(command_path, Status::Success);
+    return true;
+}
+
+template<typename T>
+static esp_err_t app_driver_light_fade_level(light_cmd_t &cmd, chip::TLV::TLVReader &reader, bool turn_on)
+{
+    T data;
+    if (data.Decode(reader) != CHIP_NO_ERROR) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // Same checks as the server: out of range is rejected, *WithOnOff always runs, the rest only while on or with
+    // ExecuteIfOff. Left as an attribute command the hook posts nothing
+    if (data.level > MATTER_BRIGHTNESS_MAX ||
+        (!turn_on && !app_driver_light_executes(cmd.endpoint_id, LevelControl::Id, data.optionsMask.Raw(), data.optionsOverride.Raw()))) {
+        return ESP_OK;
+    }
+
+    uint8_t min_level = app_driver_read_attr(cmd.endpoint_id, LevelControl::Id, LevelControl::Attributes::MinLevel::Id, 1);
+    uint8_t max_level = app_driver_read_attr(cmd.endpoint_id, LevelControl::Id, LevelControl::Attributes::MaxLevel::Id,
+                                             MATTER_BRIGHTNESS_MAX);
+
+    // A null TransitionTime means the OnOffTransitionTime attribute, as fast as possible without it
+    uint16_t transition = data.transitionTime.IsNull()
+                        ? app_driver_read_attr(cmd.endpoint_id, LevelControl::Id, LevelControl::Attributes::OnOffTransitionTime::Id, 0)
+                        : data.transitionTime.Value();
+
+    cmd.type          = LIGHT_CMD_FADE_LEVEL;
+    cmd.turn_on       = turn_on;
+    cmd.target[0]     = std::clamp<uint8_t>(data.level, min_level, std::max(min_level, max_level));
+    cmd.transition_ms = transition_to_ms(transition);
+    return ESP_OK;
+}
+
+/* Scene commands carry group and scene, the fabric comes from the session. Scenes are per fabric */
+static esp_err_t app_driver_light_scene(light_cmd_t &cmd, uint16_t group, uint8_t scene, void *opaque_ptr)
+{
+    chip::app::CommandHandler *handler = static_cast<chip::app::CommandHandler *>(opaque_ptr);
+    if (!handler) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    cmd.target[0] = group;
+    cmd.target[1] = ((uint16_t)handler->GetAccessingFabricIndex() << 8) | scene;
+    return ESP_OK;
+}
+
+static uint32_t app_driver_light_scene_key(const light_cmd_t &cmd)
+{
+    return ((uint32_t)(cmd.target[1] >> 8) << 24) | ((uint32_t)cmd.target[0] << 8) | (cmd.target[1] & 0xFF);
+}
+
+/* The Scenes Management server's own checks: the group is on the endpoint, and the scene exists or, for a store, there
+ * is room for it. The hook runs before the server, a store or recall it then rejects must not reach the driver, no
+ * attribute write would correct the output afterwards. A recall also gets the transition stored with the scene */
+static bool app_driver_light_scene_valid(const light_cmd_t &cmd, bool store, uint32_t *stored_ms)
+{
+    chip::FabricIndex fabric = cmd.target[1] >> 8;
+    uint16_t group = cmd.target[0];
+    uint8_t  scene = cmd.target[1] & 0xFF;
+
+    if (group != 0 && !chip::Credentials::GetGroupDataProvider()->HasEndpoint(fabric, group, cmd.endpoint_id)) {
+        return false;
+    }
+
+    // Same table size as the server, the table is shared and takes it from every caller
+    uint16_t table_size = app_driver_read_attr(cmd.endpoint_id, ScenesManagement::Id,
+                                               ScenesManagement::Attributes::SceneTableSize::Id,
+                                               chip::scenes::kMaxScenesPerEndpoint);
+    chip::scenes::DefaultSceneTableImpl *table = chip::scenes::GetSceneTableImpl(cmd.endpoint_id, table_size);
+
+    chip::scenes::DefaultSceneTableImpl::SceneTableEntry entry;
+    if (table->GetSceneTableEntry(fabric, chip::scenes::SceneStorageId(scene, group), entry) == CHIP_NO_ERROR) {
+        if (stored_ms) {
+            *stored_ms = entry.mStorageData.mSceneTransitionTimeMs;
+        }
+        return true;
+    }
+
+    uint8_t capacity = 0;
+    return store && table->GetRemainingCapacity(fabric, capacity) == CHIP_NO_ERROR && capacity > 0;
+}
+
+static esp_err_t app_driver_command_cb(const chip::app::ConcreteCommandPath &command_path, chip::TLV::TLVReader &tlv_data,
+                                       void *opaque_ptr)
+{
+    // Work on a copy, the stack still has to decode the same fields afterwards
+    chip::TLV::TLVReader reader;
+    reader.Init(tlv_data);
+
+    light_cmd_t cmd = {};
+    cmd.posted      = LED_LATENCY_START();
+    cmd.type        = LIGHT_CMD_ATTRIBUTE; // Stays this way for commands that are not handled here
+    cmd.endpoint_id = command_path.mEndpointId;
+
+    esp_err_t err     = ESP_OK;
+    bool      handled = false;
+    if (command_path.mClusterId == LevelControl::Id) {
+        switch (command_path.mCommandId) {
+        case LevelControl::Commands::MoveToLevel::Id:
+            err = app_driver_light_fade_level<LevelControl::Commands::MoveToLevel::DecodableType>(cmd, reader, false);
+            break;
+
+        case LevelControl::Commands::MoveToLevelWithOnOff::Id:
+            err = app_driver_light_fade_level<LevelControl::Commands::MoveToLevelWithOnOff::DecodableType>(cmd, reader, true);
+            break;
+
+        // Stop, and the commands the stack steps itself. Either way the hardware fade stops where it is and no step of
+        // theirs may be taken for one of the fade's
+        case LevelControl::Commands::Stop::Id:
+        case LevelControl::Commands::StopWithOnOff::Id:
+        case LevelControl::Commands::Move::Id:
+        case LevelControl::Commands::MoveWithOnOff::Id:
+        case LevelControl::Commands::Step::Id:
+        case LevelControl::Commands::StepWithOnOff::Id:
+            cmd.type = LIGHT_CMD_STOP_FADE;
+            break;
+        }
+    }
+
+    else if (command_path.mClusterId == ColorControl::Id) {
+        switch (command_path.mCommandId) {
+        case ColorControl::Commands::MoveToColor::Id: {
+            ColorControl::Commands::MoveToColor::DecodableType data;
+            if (data.Decode(reader) != CHIP_NO_ERROR) {
+                err = ESP_ERR_INVALID_ARG;
+                break;
+            }
+            // Constraint errors and commands ignored while off stay with the stack
+            if (data.colorX > MATTER_COLOR_MAX || data.colorY > MATTER_COLOR_MAX ||
+                !app_driver_light_executes(cmd.endpoint_id, ColorControl::Id, data.optionsMask.Raw(), data.optionsOverride.Raw())) {
+                break;
             }
+            cmd.type          = LIGHT_CMD_FADE_XY;
+            cmd.target[0]     = data.colorX;
+            cmd.target[1]     = data.colorY;
+            cmd.transition_ms = transition_to_ms(data.transitionTime);
+            break;
         }
 
-        else if (cluster_id == LevelControl::Id) {
-            if (attribute_id == LevelControl::Attributes::CurrentLevel::Id) {
-                err = app_driver_light_set_brightness(val);
+        case ColorControl::Commands::MoveToColorTemperature::Id: {
+            ColorControl::Commands::MoveToColorTemperature::DecodableType data;
+            if (data.Decode(reader) != CHIP_NO_ERROR) {
+                err = ESP_ERR_INVALID_ARG;
+                break;
             }
+            if (data.colorTemperatureMireds > MATTER_COLOR_MAX ||
+                !app_driver_light_executes(cmd.endpoint_id, ColorControl::Id, data.optionsMask.Raw(), data.optionsOverride.Raw())) {
+                break;
+            }
+
+            // The server clamps to the physical range, not an error
+            uint16_t min_mireds = app_driver_read_attr(cmd.endpoint_id, ColorControl::Id,
+                                                       ColorControl::Attributes::ColorTempPhysicalMinMireds::Id, 1);
+            uint16_t max_mireds = app_driver_read_attr(cmd.endpoint_id, ColorControl::Id,
+                                                       ColorControl::Attributes::ColorTempPhysicalMaxMireds::Id, MATTER_COLOR_MAX);
+            cmd.type          = LIGHT_CMD_FADE_TEMPERATURE;
+            cmd.target[0]     = std::clamp<uint16_t>(data.colorTemperatureMireds, min_mireds, std::max(min_mireds, max_mireds));
+            cmd.transition_ms = transition_to_ms(data.transitionTime);
+            break;
         }
 
-        else if (cluster_id == ColorControl::Id) {
-            if (attribute_id == ColorControl::Attributes::ColorTemperatureMireds::Id) {
-                err = app_driver_light_set_temperature(val);
+        case ColorControl::Commands::ColorLoopSet::Id: {
+            ColorControl::Commands::ColorLoopSet::DecodableType data;
+            if (data.Decode(reader) != CHIP_NO_ERROR) {
+                err = ESP_ERR_INVALID_ARG;
+                break;
             }
+            // Nothing to post, the driver's loop follows the ColorLoop* attributes written here
+            handled = app_driver_color_loop_set(command_path, data, opaque_ptr);
+            break;
+        }
 
-            else if (attribute_id == ColorControl::Attributes::CurrentX::Id) {
+        case ColorControl::Commands::StopMoveStep::Id:
+        case ColorControl::Commands::MoveToHue::Id:
+        case ColorControl::Commands::MoveHue::Id:
+        case ColorControl::Commands::StepHue::Id:
+        case ColorControl::Commands::MoveToSaturation::Id:
+        case ColorControl::Commands::MoveSaturation::Id:
+        case ColorControl::Commands::StepSaturation::Id:
+        case ColorControl::Commands::MoveToHueAndSaturation::Id:
+        case ColorControl::Commands::MoveColor::Id:
+        case ColorControl::Commands::StepColor::Id:
+        case ColorControl::Commands::EnhancedMoveToHue::Id:
+        case ColorControl::Commands::EnhancedMoveHue::Id:
+        case ColorControl::Commands::EnhancedStepHue::Id:
+        case ColorControl::Commands::EnhancedMoveToHueAndSaturation::Id:
+        case ColorControl::Commands::MoveColorTemperature::Id:
+        case ColorControl::Commands::StepColorTemperature::Id:
+            cmd.type = LIGHT_CMD_STOP_FADE;
+            break;
+        }
+    }
 
-                err = app_driver_light_set_x(val);
+    else if (command_path.mClusterId == ScenesManagement::Id) {
+        switch (command_path.mCommandId) {
+        case ScenesManagement::Commands::StoreScene::Id: {
+            ScenesManagement::Commands::StoreScene::DecodableType data;
+            if (data.Decode(reader) != CHIP_NO_ERROR) {
+                err = ESP_ERR_INVALID_ARG;
+                break;
             }
+            err = app_driver_light_scene(cmd, data.groupID, data.sceneID, opaque_ptr);
+            if (err == ESP_OK && app_driver_light_scene_valid(cmd, true, nullptr)) {
+                cmd.type = LIGHT_CMD_STORE_SCENE;
+            }
+            break;
+        }
 
-            else if (attribute_id == ColorControl::Attributes::CurrentY::Id) {
+        case ScenesManagement::Commands::RecallScene::Id: {
+            ScenesManagement::Commands::RecallScene::DecodableType data;
+            if (data.Decode(reader) != CHIP_NO_ERROR) {
+                err = ESP_ERR_INVALID_ARG;
+                break;
+            }
 
-                err = app_driver_light_set_y(val);
+            uint32_t stored_ms = 0;
+            err = app_driver_light_scene(cmd, data.groupID, data.sceneID, opaque_ptr);
+            if (err != ESP_OK || !app_driver_light_scene_valid(cmd, false, &stored_ms)) {
+                break;
             }
 
-            else{ESP_LOGE(TAG, "Attribute ID not supported");};
+            // Without a TransitionTime the stack uses the one stored with the scene. Scenes already use ms
+            bool given        = data.transitionTime.HasValue() && !data.transitionTime.Value().IsNull();
+            cmd.type          = LIGHT_CMD_RECALL_SCENE;
+            cmd.transition_ms = given ? data.transitionTime.Value().Value() : stored_ms;
+            break;
         }
 
-        else{ESP_LOGE(TAG, "Cluster ID not supported");};
+        // The stack changes its scene table, the cached copies go. This runs before the stack checks the command,
+        // a rejected one only costs a cache miss on the next recall
+        case ScenesManagement::Commands::AddScene::Id: {
+            ScenesManagement::Commands::AddScene::DecodableType data;
+            if (data.Decode(reader) != CHIP_NO_ERROR) {
+                err = ESP_ERR_INVALID_ARG;
+                break;
+            }
+            err = app_driver_light_scene(cmd, data.groupID, data.sceneID, opaque_ptr);
+            cmd.type = LIGHT_CMD_FORGET_SCENE;
+            break;
+        }
+
+        case ScenesManagement::Commands::RemoveScene::Id: {
+            ScenesManagement::Commands::RemoveScene::DecodableType data;
+            if (data.Decode(reader) != CHIP_NO_ERROR) {
+                err = ESP_ERR_INVALID_ARG;
+                break;
+            }
+            err = app_driver_light_scene(cmd, data.groupID, data.sceneID, opaque_ptr);
+            cmd.type = LIGHT_CMD_FORGET_SCENE;
+            break;
+        }
+
+        case ScenesManagement::Commands::RemoveAllScenes::Id: {
+            ScenesManagement::Commands::RemoveAllScenes::DecodableType data;
+            if (data.Decode(reader) != CHIP_NO_ERROR) {
+                err = ESP_ERR_INVALID_ARG;
+                break;
+            }
+            err = app_driver_light_scene(cmd, data.groupID, 0, opaque_ptr);
+            cmd.type = LIGHT_CMD_FORGET_GROUP;
+            break;
+        }
+
+        case ScenesManagement::Commands::CopyScene::Id: {
+            // One scene or all of them, either way only into the destination group
+            ScenesManagement::Commands::CopyScene::DecodableType data;
+            if (data.Decode(reader) != CHIP_NO_ERROR) {
+                err = ESP_ERR_INVALID_ARG;
+                break;
+            }
+            err = app_driver_light_scene(cmd, data.groupIdentifierTo, 0, opaque_ptr);
+            cmd.type = LIGHT_CMD_FORGET_GROUP;
+            break;
+        }
+        }
+    }
+
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Command hook failed for cluster 0x%" PRIx32 " command 0x%" PRIx32, command_path.mClusterId, command_path.mCommandId);
+    }
+    else if (cmd.type != LIGHT_CMD_ATTRIBUTE && app_driver_light_get(cmd.endpoint_id)) {
+        LED_TRACE(TRACE_APP_COMMAND, cmd.type, ((uint32_t)cmd.target[0] << 16) | cmd.target[1], cmd.transition_ms);
+        app_driver_post(cmd);
+    }
+
+    // esp_matter only runs the stack's handler after an ESP_OK. A ColorLoopSet answered here must not reach it, every
+    // other command still does and the stack owns the attribute state
+    return handled ? ESP_FAIL : ESP_OK;
+}
+
+void app_driver_light_forget_scenes()
+{
+    for (uint16_t endpoint_id = 0; endpoint_id < LIGHT_MAX_ENDPOINTS; endpoint_id++) {
+        if (light_endpoints[endpoint_id].driver) {
+            light_cmd_t cmd = {};
+            cmd.posted      = LED_LATENCY_START();
+            cmd.type        = LIGHT_CMD_FORGET_ALL;
+            cmd.endpoint_id = endpoint_id;
+            app_driver_post(cmd);
+        }
+    }
+}
+
+esp_err_t app_driver_light_register_commands(uint16_t endpoint_id)
+{
+    static const struct {
+        uint32_t cluster_id;
+        uint32_t command_id;
+    } hooks[] = {
+        { LevelControl::Id, LevelControl::Commands::MoveToLevel::Id },
+        { LevelControl::Id, LevelControl::Commands::MoveToLevelWithOnOff::Id },
+        { LevelControl::Id, LevelControl::Commands::Stop::Id },
+        { LevelControl::Id, LevelControl::Commands::StopWithOnOff::Id },
+        { LevelControl::Id, LevelControl::Commands::Move::Id },
+        { LevelControl::Id, LevelControl::Commands::MoveWithOnOff::Id },
+        { LevelControl::Id, LevelControl::Commands::Step::Id },
+        { LevelControl::Id, LevelControl::Commands::StepWithOnOff::Id },
+        { ColorControl::Id, ColorControl::Commands::MoveToColor::Id },
+        { ColorControl::Id, ColorControl::Commands::MoveToColorTemperature::Id },
+        { ColorControl::Id, ColorControl::Commands::ColorLoopSet::Id },
+        { ColorControl::Id, ColorControl::Commands::StopMoveStep::Id },
+        { ColorControl::Id, ColorControl::Commands::MoveToHue::Id },
+        { ColorControl::Id, ColorControl::Commands::MoveHue::Id },
+        { ColorControl::Id, ColorControl::Commands::StepHue::Id },
+        { ColorControl::Id, ColorControl::Commands::MoveToSaturation::Id },
+        { ColorControl::Id, ColorControl::Commands::MoveSaturation::Id },
+        { ColorControl::Id, ColorControl::Commands::StepSaturation::Id },
+        { ColorControl::Id, ColorControl::Commands::MoveToHueAndSaturation::Id },
+        { ColorControl::Id, ColorControl::Commands::MoveColor::Id },
+        { ColorControl::Id, ColorControl::Commands::StepColor::Id },
+        { ColorControl::Id, ColorControl::Commands::EnhancedMoveToHue::Id },
+        { ColorControl::Id, ColorControl::Commands::EnhancedMoveHue::Id },
+        { ColorControl::Id, ColorControl::Commands::EnhancedStepHue::Id },
+        { ColorControl::Id, ColorControl::Commands::EnhancedMoveToHueAndSaturation::Id },
+        { ColorControl::Id, ColorControl::Commands::MoveColorTemperature::Id },
+        { ColorControl::Id, ColorControl::Commands::StepColorTemperature::Id },
+        { ScenesManagement::Id, ScenesManagement::Commands::StoreScene::Id },
+        { ScenesManagement::Id, ScenesManagement::Commands::RecallScene::Id },
+        { ScenesManagement::Id, ScenesManagement::Commands::AddScene::Id },
+        { ScenesManagement::Id, ScenesManagement::Commands::RemoveScene::Id },
+        { ScenesManagement::Id, ScenesManagement::Commands::RemoveAllScenes::Id },
+        { ScenesManagement::Id, ScenesManagement::Commands::CopyScene::Id },
+    };
+
+    esp_err_t err = ESP_OK;
+    for (const auto &hook : hooks) {
+        cluster_t *cluster = cluster::get(endpoint_id, hook.cluster_id);
+        command_t *command = cluster ? command::get(cluster, hook.command_id, COMMAND_FLAG_ACCEPTED) : nullptr;
+        if (!command) {
+            // Fine, not every fixture kind has every command (no MoveToColor on a CCT light)
+            ESP_LOGD(TAG, "Command 0x%" PRIx32 " not found on endpoint %d", hook.command_id, endpoint_id);
+            continue;
+        }
+        command::set_user_callback(command, app_driver_command_cb);
     }
     return err;
 }
 /* ------------------------------------------------------------------------------------------------------ */
 
 
-/* Sets the initial default values at startup or any initilization. Doesnt matter too much from my experience */
-esp_err_t app_driver_light_set_defaults(uint16_t endpoint_id)
+/* Callback that runs whenever an attribute updates. Only queues the new value for the render task */
+esp_err_t app_driver_attribute_update(app_driver_handle_t driver_handle, uint16_t endpoint_id, uint32_t cluster_id,
+                                      uint32_t attribute_id, esp_matter_attr_val_t *val)
+{
+    // Only light endpoints carry a driver handle
+    if (!driver_handle) {
+        return ESP_OK;
+    }
+
+    // Attributes the light doesn't follow never take a queue slot
+    uint8_t attribute = app_driver_light_find_attr(cluster_id, attribute_id);
+    if (attribute == LIGHT_ATTR_COUNT) {
+        return ESP_OK;
+    }
+
+    light_cmd_t cmd = {};
+    cmd.posted      = LED_LATENCY_START();
+    cmd.type        = LIGHT_CMD_ATTRIBUTE;
+    cmd.attribute   = attribute;
+    cmd.endpoint_id = endpoint_id;
+    cmd.val         = *val;
+
+    LED_TRACE(TRACE_APP_ATTRIBUTE, 0, cluster_id, attribute_id);
+    app_driver_post(cmd);
+    return ESP_OK;
+}
+/* ------------------------------------------------------------------------------------------------------ */
+
+
+/* Applies one queued change to its endpoint's driver. Render task only */
+static esp_err_t app_driver_light_apply(light_cmd_t &cmd)
+{
+    LED_Driver *driver = app_driver_light_get(cmd.endpoint_id);
+    if (!driver) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    switch (cmd.type) {
+    case LIGHT_CMD_ATTRIBUTE:
+        return light_attr_table[cmd.attribute].apply(driver, &cmd.val);
+
+    case LIGHT_CMD_FADE_LEVEL:
+        return driver->fade_brightness(cmd.target[0], cmd.transition_ms, cmd.turn_on);
+
+    case LIGHT_CMD_FADE_XY:
+        return driver->fade_colorXY(cmd.target[0], cmd.target[1], cmd.transition_ms);
+
+    case LIGHT_CMD_FADE_TEMPERATURE:
+        return driver->fade_temperature(cmd.target[0], cmd.transition_ms);
+
+    case LIGHT_CMD_STOP_FADE:
+        // Freeze where the hardware is, then take the values the stack stopped at
+        resync_pending |= 1u << cmd.endpoint_id;
+        return driver->stop_fade();
+
+    case LIGHT_CMD_STORE_SCENE:
+        // A scene that could not be cached (color loop or fade running) is recalled through the attributes instead
+        driver->store_scene(app_driver_light_scene_key(cmd));
+        return ESP_OK;
+
+    case LIGHT_CMD_RECALL_SCENE:
+        // Not cached, e.g. stored before a reboot: the stack's attribute writes bring the scene instead
+        driver->recall_scene(app_driver_light_scene_key(cmd), cmd.transition_ms);
+        return ESP_OK;
+
+    case LIGHT_CMD_FORGET_SCENE:
+        driver->forget_scenes(app_driver_light_scene_key(cmd), UINT32_MAX);
+        return ESP_OK;
+
+    case LIGHT_CMD_FORGET_GROUP:
+        driver->forget_scenes(app_driver_light_scene_key(cmd), 0xFFFFFF00); // Fabric and group, any scene
+        return ESP_OK;
+
+    case LIGHT_CMD_FORGET_ALL:
+        driver->forget_scenes(0, 0);
+        return ESP_OK;
+    }
+    return ESP_OK;
+}
+/* ------------------------------------------------------------------------------------------------------ */
+
+
+/* Stages every driver attribute from the data model through the cached handles. Render task only, with the CHIP
+ * stack locked */
+static esp_err_t app_driver_light_stage_defaults(light_endpoint_t &light)
 {
     esp_err_t err = ESP_OK;
-    void *priv_data = endpoint::get_priv_data(endpoint_id);
-    led_driver_handle_t handle = (led_driver_handle_t)priv_data;
     esp_matter_attr_val_t val = esp_matter_invalid(NULL);
-    
-    /* Setting brightness */
-    attribute_t *attribute = attribute::get(endpoint_id, LevelControl::Id, LevelControl::Attributes::CurrentLevel::Id);
-    attribute::get_val(attribute, &val);
-    err |= app_driver_light_set_brightness(&val);
 
-    /* Setting color */
-    attribute = attribute::get(endpoint_id, ColorControl::Id, ColorControl::Attributes::ColorMode::Id);
-    attribute::get_val(attribute, &val);
+    // Only the color values of the active mode are applied, the driver switches mode on whichever it gets last
+    uint8_t color_modes = LIGHT_ATTR_ANY_MODE;
+    if (light.color_mode && attribute::get_val(light.color_mode, &val) == ESP_OK) {
+        color_modes = 1u << val.val.u8;
+    }
+
+    for (size_t i = 0; i < LIGHT_ATTR_COUNT; i++) {
+        const light_attr_handler_t &row = light_attr_table[i];
+        if (!light.attributes[i] || !(row.color_modes & color_modes)) {
+            continue;
+        }
+
+        if (attribute::get_val(light.attributes[i], &val) == ESP_OK) {
+            err |= row.apply(light.driver, &val);
+        }
+    }
+    return err;
+}
+
+/* Sets the initial default values at startup or any initilization. Doesnt matter too much from my experience.
+ * The render task reads the data model and applies it asynchronously */
+esp_err_t app_driver_light_set_defaults(uint16_t endpoint_id)
+{
+    if (!app_driver_light_get(endpoint_id)) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    resync_pending |= 1u << endpoint_id;
+    xTaskNotifyGive(render_task);
+    return ESP_OK;
+}
+/* ---------------------------------------------------------------------------------------------------------- */
 
-    if (val.val.u8 == (uint8_t)ColorControl::ColorMode::kColorTemperature) {
-        /* Setting temperature */
-        attribute = attribute::get(endpoint_id, ColorControl::Id, ColorControl::Attributes::ColorTemperatureMireds::Id);
-        attribute::get_val(attribute, &val);
-        err |= app_driver_light_set_temperature(&val);
+
+/* Whether the driver has any channel on, what the boot timeline counts as first light */
+static bool app_driver_light_lit(const LED_Driver *driver)
+{
+    led_output_t out;
+    driver->get_output(&out);
+    return out.red || out.green || out.blue || out.white || out.warmwhite;
+}
+
+/* Render task. Drains everything queued, staging it in the driver (later values simply overwrite earlier ones for
+ * the same attribute), then commits once */
+static void app_driver_render_pass()
+{
+    light_cmd_t cmd;
+    bool     pending = false;
+    uint32_t oldest  = 0;
+
+    while (light_queue.pop(cmd)) {
+        LED_LATENCY_RECORD(LATENCY_DISPATCH, cmd.posted);
+        if (!pending) {
+            pending = true;
+            oldest  = cmd.posted;
+        }
+
+        esp_err_t err = app_driver_light_apply(cmd);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to apply light command %d: %s", cmd.type, esp_err_to_name(err));
+        }
     }
 
-    else if (val.val.u8 == (uint8_t)ColorControl::ColorMode::kCurrentXAndCurrentY) {
+    uint32_t resync = resync_pending.exchange(0);
+    if (resync) {
+        LED_TRACE(TRACE_APP_RESYNC, 0, resync, 0);
+        chip::DeviceLayer::PlatformMgr().LockChipStack();
+        for (uint16_t endpoint_id = 0; endpoint_id < LIGHT_MAX_ENDPOINTS; endpoint_id++) {
+            if (light_endpoints[endpoint_id].driver && (resync & (1u << endpoint_id))) {
+                app_driver_light_stage_defaults(light_endpoints[endpoint_id]);
+            }
+        }
+        chip::DeviceLayer::PlatformMgr().UnlockChipStack();
+    }
 
-        attribute = attribute::get(endpoint_id, ColorControl::Id, ColorControl::Attributes::CurrentX::Id);
-        attribute::get_val(attribute, &val);
-        err |= app_driver_light_set_x(&val);
+    // Drivers that nothing was staged on return right away. A reconcile to off is not the first light, whichever
+    // later commit turns a light on is
+    static bool first_light = false;
+    for (light_endpoint_t &light : light_endpoints) {
+        if (light.driver) {
+            light.driver->commit();
+            if (!first_light && app_driver_light_lit(light.driver)) {
+                first_light = true;
+                app_boot_mark(BOOT_PHASE_FIRST_LIGHT);
+            }
+        }
+    }
 
-        attribute = attribute::get(endpoint_id, ColorControl::Id, ColorControl::Attributes::CurrentY::Id);
-        attribute::get_val(attribute, &val);
-        err |= app_driver_light_set_y(&val);
+    if (resync) {
+        app_boot_mark(BOOT_PHASE_RECONCILED);
     }
 
-    /* Setting power */
-    attribute = attribute::get(endpoint_id, OnOff::Id, OnOff::Attributes::OnOff::Id);
-    attribute::get_val(attribute, &val);
-    err |= app_driver_light_set_power(&val);
+    if (pending) {
+        LED_LATENCY_RECORD(LATENCY_TOTAL, oldest);
+    }
+}
 
-    return err;
+/* Color loop frames. A periodic timer wakes the render task, which steps every running loop straight to LEDC. The hue
+ * goes back to the data model at a throttled rate only, a whole turn never turns into a stream of attribute writes */
+static esp_timer_handle_t color_loop_timer = nullptr;
+static std::atomic<bool> color_loop_frame = {false};
+
+static void app_driver_color_loop_tick(void *arg)
+{
+    color_loop_frame = true;
+    xTaskNotifyGive(render_task);
+}
+
+static void app_driver_color_loop_report(intptr_t arg)
+{
+    uint16_t endpoint_id = arg >> 16;
+    esp_matter_attr_val_t val = esp_matter_uint16((uint16_t)arg);
+    attribute::update(endpoint_id, ColorControl::Id, ColorControl::Attributes::EnhancedCurrentHue::Id, &val);
+
+    val = esp_matter_uint8((uint16_t)arg >> 8);
+    attribute::update(endpoint_id, ColorControl::Id, ColorControl::Attributes::CurrentHue::Id, &val);
+}
+
+static void app_driver_color_loop_pass()
+{
+    bool frame   = color_loop_frame.exchange(false);
+    bool running = false;
+    int64_t now  = esp_timer_get_time();
+
+    for (uint16_t endpoint_id = 0; endpoint_id < LIGHT_MAX_ENDPOINTS; endpoint_id++) {
+        light_endpoint_t &light = light_endpoints[endpoint_id];
+        if (!light.driver || !light.driver->color_loop_running()) {
+            continue;
+        }
+        running = true;
+
+        if (frame) {
+            light.driver->color_loop_step();
+        }
+
+        if (now - light.loop_reported_us >= CONFIG_APP_COLOR_LOOP_REPORT_MS * 1000LL) {
+            light.loop_reported_us = now;
+            chip::DeviceLayer::PlatformMgr().ScheduleWork(app_driver_color_loop_report,
+                                                          ((intptr_t)endpoint_id << 16) | light.driver->color_loop_hue());
+        }
+    }
+
+    // The timer only runs while some loop does
+    if (running && !esp_timer_is_active(color_loop_timer)) {
+        esp_timer_start_periodic(color_loop_timer, CONFIG_APP_COLOR_LOOP_FRAME_MS * 1000ULL);
+    }
+    else if (!running && esp_timer_is_active(color_loop_timer)) {
+        esp_timer_stop(color_loop_timer);
+    }
+}
+
+static void app_driver_render_task(void *arg)
+{
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+#if CONFIG_APP_COMMIT_WINDOW_MS > 0
+        // Let the rest of the window's changes queue up behind the first one. Color loop frames alone don't wait
+        if (!light_queue.empty()) {
+            vTaskDelay(pdMS_TO_TICKS(CONFIG_APP_COMMIT_WINDOW_MS));
+        }
+#endif
+#if CONFIG_LED_DRIVER_STRIP
+        // Every strip segment this pass touches goes out in one frame
+        led_strip_out_batch_begin();
+#endif
+        app_driver_render_pass();
+        app_driver_color_loop_pass();
+#if CONFIG_LED_DRIVER_STRIP
+        led_strip_out_batch_end();
+#endif
+    }
 }
 /* ---------------------------------------------------------------------------------------------------------- */
 
 /* Initialize everything needed for the hardware/software layers */
-app_driver_handle_t app_driver_light_init()
+size_t app_driver_light_fixture_count()
 {
+    return LIGHT_LEDC_FIXTURES + LIGHT_STRIP_SEGMENTS;
+}
+
+light_fixture_kind_t app_driver_light_fixture_kind(size_t fixture)
+{
+    return app_driver_light_fixture(fixture).kind;
+}
 
+app_driver_handle_t app_driver_light_init(size_t fixture)
+{
     /* Initialize Hardware Layer */
-    LED_GPIO_MAP map = {};
-    map.red.gpio   = PIN_R;
-    map.green.gpio = PIN_G;
-    map.blue.gpio  = PIN_B;
-    map.white.gpio = PIN_W;
-    map.warmwhite.gpio = PIN_WW;
-
-    LED_Interface = new LED_Driver(map); // Allocate the instance
-    
-    return (app_driver_handle_t)nullptr;
-}
\ No newline at end of file
+    LED_GPIO_MAP map = app_driver_light_fixture(fixture).map;
+    map.snapshot_slot = fixture;
+    if (led_driver_assign_channels(&map) != ESP_OK) {
+        ESP_LOGE(TAG, "Out of LEDC channels/timers for fixture %u", (unsigned)fixture);
+        return nullptr;
+    }
+
+    LED_Driver *driver = new LED_Driver(map); // Allocate the instance
+
+    // The constructor already put the fixture's last output back on if there was one
+    if (app_driver_light_lit(driver)) {
+        app_boot_mark(BOOT_PHASE_FIRST_LIGHT);
+    }
+
+    /* Everything after this point reaches the drivers through the render task */
+    if (!render_task) {
+        const esp_timer_create_args_t color_loop_timer_args = {
+            .callback = app_driver_color_loop_tick,
+            .arg      = nullptr,
+            .dispatch_method = ESP_TIMER_TASK,
+            .name     = "color_loop",
+            .skip_unhandled_events = true,
+        };
+        esp_timer_create(&color_loop_timer_args, &color_loop_timer);
+
+        xTaskCreate(app_driver_render_task, "light_render", CONFIG_APP_RENDER_TASK_STACK_SIZE, nullptr,
+                    CONFIG_APP_RENDER_TASK_PRIORITY, &render_task);
+    }
+
+    return (app_driver_handle_t)driver;
+}
+
+esp_err_t app_driver_light_bind(uint16_t endpoint_id, app_driver_handle_t driver_handle)
+{
+    if (endpoint_id >= LIGHT_MAX_ENDPOINTS || !driver_handle) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    light_endpoint_t &light = light_endpoints[endpoint_id];
+
+    // Resolve the handles once, attribute::get() walks the data model
+    light.color_mode = attribute::get(endpoint_id, ColorControl::Id, ColorControl::Attributes::EnhancedColorMode::Id);
+    for (size_t i = 0; i < LIGHT_ATTR_COUNT; i++) {
+        light.attributes[i] = attribute::get(endpoint_id, light_attr_table[i].cluster_id, light_attr_table[i].attribute_id);
+    }
+
+    light.driver = (LED_Driver *)driver_handle;
+    return ESP_OK;
+}
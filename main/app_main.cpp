@@ -9,6 +9,7 @@
 #include <esp_matter_ota.h>
 
 #include <app_priv.h>
+#include <led_driver.h>
 #if CHIP_DEVICE_CONFIG_ENABLE_THREAD
 #include <platform/ESP32/OpenthreadLauncher.h>
 #endif
@@ -17,7 +18,10 @@
 #include <app/server/Server.h>
 
 static const char *TAG = "app_main";
-uint16_t light_endpoint_id = 0;
+
+/* Endpoint of every initialized fixture, in fixture order */
+static uint16_t light_endpoint_ids[CONFIG_ESP_MATTER_MAX_DYNAMIC_ENDPOINT_COUNT] = {};
+static size_t light_endpoint_count = 0;
 
 using namespace esp_matter;
 using namespace esp_matter::attribute;
@@ -31,10 +35,13 @@ static void app_event_cb(const ChipDeviceEvent *event, intptr_t arg)
     switch (event->Type) {
     case chip::DeviceLayer::DeviceEventType::kInterfaceIpAddressChanged:
         ESP_LOGI(TAG, "Interface IP Address changed");
+        app_boot_mark(BOOT_PHASE_NETWORK);
         break;
 
     case chip::DeviceLayer::DeviceEventType::kCommissioningComplete:
         ESP_LOGI(TAG, "Commissioning complete");
+        app_boot_mark(BOOT_PHASE_COMMISSIONED);
+        app_memory_sample("commissioned", nullptr);
         break;
 
     case chip::DeviceLayer::DeviceEventType::kFailSafeTimerExpired:
@@ -60,6 +67,8 @@ static void app_event_cb(const ChipDeviceEvent *event, intptr_t arg)
     case chip::DeviceLayer::DeviceEventType::kFabricRemoved:
         {
             ESP_LOGI(TAG, "Fabric removed successfully");
+            // Its scenes went with it, the drivers' cached copies must not be recalled under a reused fabric index
+            app_driver_light_forget_scenes();
             if (chip::Server::GetInstance().GetFabricTable().FabricCount() == 0)
             {
                 chip::CommissioningWindowManager & commissionMgr = chip::Server::GetInstance().GetCommissioningWindowManager();
@@ -94,6 +103,7 @@ static void app_event_cb(const ChipDeviceEvent *event, intptr_t arg)
 
     case chip::DeviceLayer::DeviceEventType::kBLEDeinitialized:
         ESP_LOGI(TAG, "BLE deinitialized and memory reclaimed");
+        app_memory_sample("ble_deinit", nullptr);
         break;
 
     default:
@@ -119,6 +129,8 @@ static esp_err_t app_attribute_update_cb(attribute::callback_type_t type, uint16
     esp_err_t err = ESP_OK;
 
     if (type == PRE_UPDATE) {
+        app_record_attribute(endpoint_id, cluster_id, attribute_id, val);
+
         /* Driver update */
         app_driver_handle_t driver_handle = (app_driver_handle_t)priv_data;
         err = app_driver_attribute_update(driver_handle, endpoint_id, cluster_id, attribute_id, val);
@@ -127,25 +139,27 @@ static esp_err_t app_attribute_update_cb(attribute::callback_type_t type, uint16
     return err;
 }
 
-extern "C" void app_main()
+/* Creates the endpoint for one fixture, with the device type matching what it can show */
+static endpoint_t *app_create_light_endpoint(node_t *node, light_fixture_kind_t kind, app_driver_handle_t light_handle)
 {
-    esp_err_t err = ESP_OK;
-
-    /* Initialize the ESP NVS layer */
-    nvs_flash_init();
+    if (kind == LIGHT_FIXTURE_CCT) {
+        color_temperature_light::config_t light_config;
+        light_config.on_off.on_off = DEFAULT_POWER;
+        light_config.on_off.lighting.start_up_on_off = nullptr;
 
-    //MEMORY_PROFILER_DUMP_HEAP_STAT("Bootup");
+        light_config.level_control.current_level = DEFAULT_BRIGHTNESS;
+        light_config.level_control.on_level = DEFAULT_BRIGHTNESS;
+        light_config.level_control.lighting.start_up_current_level = DEFAULT_BRIGHTNESS;
 
-    /* Initialize driver */
-    app_driver_handle_t light_handle = app_driver_light_init();
-   // app_driver_handle_t button_handle = app_driver_button_init();
-    //app_reset_button_register(button_handle);
+        light_config.color_control.color_mode = static_cast<uint8_t>(ColorControl::ColorMode::kColorTemperature);
+        light_config.color_control.enhanced_color_mode = static_cast<uint8_t>(ColorControl::ColorMode::kColorTemperature);
 
-    /* Create a Matter node and add the mandatory Root Node device type on endpoint 0 */
-    node::config_t node_config;
+        light_config.color_control.color_temperature.startup_color_temperature_mireds = nullptr;
+        light_config.color_control.color_temperature.color_temp_physical_max_mireds = LED_CCT_MIRED_MAX;
+        light_config.color_control.color_temperature.color_temp_physical_min_mireds = LED_CCT_MIRED_MIN;
 
-    // node handle can be used to add/modify other endpoints.
-    node_t *node = node::create(&node_config, app_attribute_update_cb, app_identification_cb);
+        return color_temperature_light::create(node, &light_config, ENDPOINT_FLAG_NONE, light_handle);
+    }
 
     // CONFIG #1 ---------------------------------------------------------------------------------------------------------------------------
     extended_color_light::config_t light_config;
@@ -160,8 +174,8 @@ extern "C" void app_main()
     light_config.color_control.enhanced_color_mode = static_cast<uint8_t>(ColorControl::ColorMode::kCurrentXAndCurrentY);
 
     light_config.color_control.color_temperature.startup_color_temperature_mireds = nullptr;
-    light_config.color_control.color_temperature.color_temp_physical_max_mireds = 370;
-    light_config.color_control.color_temperature.color_temp_physical_min_mireds = 153;
+    light_config.color_control.color_temperature.color_temp_physical_max_mireds = LED_CCT_MIRED_MAX;
+    light_config.color_control.color_temperature.color_temp_physical_min_mireds = LED_CCT_MIRED_MIN;
 
     // 1. Set all capabilities for maximum compatibility
     light_config.color_control.color_capabilities =
@@ -172,24 +186,101 @@ extern "C" void app_main()
 
     // endpoint handles can be used to add/modify clusters.
     endpoint_t *endpoint = extended_color_light::create(node, &light_config, ENDPOINT_FLAG_NONE, light_handle);
-    //ABORT_APP_ON_FAILURE(endpoint != nullptr, ESP_LOGE(TAG, "Failed to create extended color light endpoint"));
 
-    light_endpoint_id = endpoint::get_id(endpoint);
-    ESP_LOGW(TAG, "xyLight created with endpoint_id %d", light_endpoint_id);
+    // 2. The device type only brings xy and color temperature, add the hue modes and color loop advertised above
+    cluster_t *color_control = cluster::get(endpoint, ColorControl::Id);
+
+    cluster::color_control::feature::hue_saturation::config_t hue_saturation_config;
+    cluster::color_control::feature::hue_saturation::add(color_control, &hue_saturation_config);
 
-    /* Mark deferred persistence for some attributes that might be changed rapidly */
-    attribute_t *current_level_attribute = attribute::get(light_endpoint_id, LevelControl::Id, LevelControl::Attributes::CurrentLevel::Id);
-    attribute::set_deferred_persistence(current_level_attribute);
+    cluster::color_control::feature::enhanced_hue::config_t enhanced_hue_config;
+    cluster::color_control::feature::enhanced_hue::add(color_control, &enhanced_hue_config);
 
-    attribute_t *current_x_attribute = attribute::get(light_endpoint_id, ColorControl::Id, ColorControl::Attributes::CurrentX::Id);
-    attribute::set_deferred_persistence(current_x_attribute);
-    attribute_t *current_y_attribute = attribute::get(light_endpoint_id, ColorControl::Id, ColorControl::Attributes::CurrentY::Id);
-    attribute::set_deferred_persistence(current_y_attribute);
+    cluster::color_control::feature::color_loop::config_t color_loop_config;
+    cluster::color_control::feature::color_loop::add(color_control, &color_loop_config);
 
-    attribute_t *color_temp_attribute = attribute::get(light_endpoint_id, ColorControl::Id, ColorControl::Attributes::ColorTemperatureMireds::Id);
-    attribute::set_deferred_persistence(color_temp_attribute);
+    return endpoint;
+}
+
+extern "C" void app_main()
+{
+    esp_err_t err = ESP_OK;
+    app_boot_mark(BOOT_PHASE_APP_MAIN);
+
+    /* Initialize the ESP NVS layer */
+    nvs_flash_init();
+    app_boot_mark(BOOT_PHASE_NVS);
+
+    /* Drivers first, each one puts its fixture's last output back on before the Matter stack starts coming up */
+    app_driver_handle_t light_handles[CONFIG_ESP_MATTER_MAX_DYNAMIC_ENDPOINT_COUNT] = {};
+    size_t light_fixture_count = std::min<size_t>(app_driver_light_fixture_count(), CONFIG_ESP_MATTER_MAX_DYNAMIC_ENDPOINT_COUNT);
+    for (size_t fixture = 0; fixture < light_fixture_count; fixture++) {
+        light_handles[fixture] = app_driver_light_init(fixture);
+    }
+    app_boot_mark(BOOT_PHASE_DRIVERS);
+
+    app_memory_sample("boot", nullptr);
+
+   // app_driver_handle_t button_handle = app_driver_button_init();
+    //app_reset_button_register(button_handle);
+
+    /* Create a Matter node and add the mandatory Root Node device type on endpoint 0 */
+    node::config_t node_config;
+
+    // node handle can be used to add/modify other endpoints.
+    node_t *node = node::create(&node_config, app_attribute_update_cb, app_identification_cb);
+    app_boot_mark(BOOT_PHASE_NODE);
+    endpoint_t *endpoint = nullptr;
+
+    /* One light endpoint per fixture, the driver handle is the endpoint's priv_data */
+    for (size_t fixture = 0; fixture < light_fixture_count; fixture++) {
+        app_driver_handle_t light_handle = light_handles[fixture];
+        if (!light_handle) {
+            continue;
+        }
+
+        // A fixture that can't get an endpoint or a driver slot stays dark, the others still come up
+        endpoint = app_create_light_endpoint(node, app_driver_light_fixture_kind(fixture), light_handle);
+        if (!endpoint) {
+            ESP_LOGE(TAG, "Failed to create the light endpoint for fixture %u", (unsigned)fixture);
+            continue;
+        }
+
+        uint16_t light_endpoint_id = endpoint::get_id(endpoint);
+        err = app_driver_light_bind(light_endpoint_id, light_handle);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to bind fixture %u to endpoint %d: %s", (unsigned)fixture, light_endpoint_id,
+                     esp_err_to_name(err));
+            continue;
+        }
+        light_endpoint_ids[light_endpoint_count++] = light_endpoint_id;
+        ESP_LOGW(TAG, "Light for fixture %u created with endpoint_id %d", (unsigned)fixture, light_endpoint_id);
+
+        /* Mark deferred persistence for some attributes that might be changed rapidly. A CCT light has no color ones */
+        static const struct {
+            uint32_t cluster_id;
+            uint32_t attribute_id;
+        } deferred[] = {
+            { LevelControl::Id, LevelControl::Attributes::CurrentLevel::Id },
+            { ColorControl::Id, ColorControl::Attributes::CurrentX::Id },
+            { ColorControl::Id, ColorControl::Attributes::CurrentY::Id },
+            { ColorControl::Id, ColorControl::Attributes::ColorTemperatureMireds::Id },
+            { ColorControl::Id, ColorControl::Attributes::CurrentHue::Id },
+            { ColorControl::Id, ColorControl::Attributes::EnhancedCurrentHue::Id },
+            { ColorControl::Id, ColorControl::Attributes::CurrentSaturation::Id },
+        };
+        for (const auto &entry : deferred) {
+            attribute_t *attribute = attribute::get(light_endpoint_id, entry.cluster_id, entry.attribute_id);
+            if (attribute) {
+                attribute::set_deferred_persistence(attribute);
+            }
+        }
+
+        /* Hand move-to transitions to the hardware fader */
+        app_driver_light_register_commands(light_endpoint_id);
+    }
+    app_boot_mark(BOOT_PHASE_ENDPOINTS);
 
- 
 #if CHIP_DEVICE_CONFIG_ENABLE_THREAD && CHIP_DEVICE_CONFIG_ENABLE_WIFI_STATION
     // Enable secondary network interface
     secondary_network_interface::config_t secondary_network_interface_config;
@@ -208,14 +299,20 @@ extern "C" void app_main()
 
     /* Matter start */
     err = esp_matter::start(app_event_cb);
+    app_boot_mark(BOOT_PHASE_MATTER_START);
+    app_memory_sample("started", nullptr);
+    app_memory_init();
 
-    /* Starting driver with default values */
-    app_driver_light_set_defaults(light_endpoint_id);
+    /* Reconcile the drivers with the data model, this replaces the restored boot output */
+    for (size_t i = 0; i < light_endpoint_count; i++) {
+        app_driver_light_set_defaults(light_endpoint_ids[i]);
+    }
 
 #if CONFIG_ENABLE_CHIP_SHELL
     esp_matter::console::diagnostics_register_commands();
     esp_matter::console::wifi_register_commands();
     esp_matter::console::factoryreset_register_commands();
+    app_console_register_commands();
 #if CONFIG_OPENTHREAD_CLI
     esp_matter::console::otcli_register_commands();
 #endif
@@ -0,0 +1,131 @@
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <esp_heap_caps.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <inttypes.h>
+#include <stdio.h>
+
+#include <app_priv.h>
+
+static const char *TAG = "app_memory";
+
+/* Tasks whose stack high water mark is tracked. Looked up by name, the ones that don't exist (yet) read 0 */
+static const char *memory_task_names[APP_MEMORY_TASKS] = {
+    "CHIP",         // Matter stack
+    "ot_task",      // OpenThread
+    "light_render", // Our render task
+    "esp_timer",    // Color loop frames, snapshot writes
+};
+
+static TaskHandle_t memory_tasks[APP_MEMORY_TASKS] = {};
+
+static app_memory_sample_t memory_ring[CONFIG_APP_MEMORY_RING_LEN];
+static uint32_t            memory_head = 0; // Samples taken so far, the ring slot is head % len
+static app_memory_sample_t memory_min  = {}; // Lowest value of every field since boot
+static portMUX_TYPE        memory_lock = portMUX_INITIALIZER_UNLOCKED; // CHIP task, timer task and console all sample
+
+static esp_timer_handle_t memory_timer = nullptr;
+
+void app_memory_sample(const char *label, app_memory_sample_t *out)
+{
+    app_memory_sample_t sample = {};
+    sample.time_us       = esp_timer_get_time();
+    sample.label         = label;
+    sample.free_heap     = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    sample.min_free_heap = heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT);
+    sample.largest_block = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+
+    for (int i = 0; i < APP_MEMORY_TASKS; i++) {
+        // xTaskGetHandle() walks every task list, only until the task showed up once
+        if (!memory_tasks[i]) {
+            memory_tasks[i] = xTaskGetHandle(memory_task_names[i]);
+        }
+        sample.stack_free[i] = memory_tasks[i] ? uxTaskGetStackHighWaterMark(memory_tasks[i]) : 0;
+    }
+
+    portENTER_CRITICAL(&memory_lock);
+    memory_ring[memory_head++ % CONFIG_APP_MEMORY_RING_LEN] = sample;
+
+    if (memory_head == 1) {
+        memory_min = sample;
+    }
+    memory_min.time_us       = sample.time_us;
+    memory_min.free_heap     = std::min(memory_min.free_heap, sample.free_heap);
+    memory_min.min_free_heap = std::min(memory_min.min_free_heap, sample.min_free_heap);
+    memory_min.largest_block = std::min(memory_min.largest_block, sample.largest_block);
+    for (int i = 0; i < APP_MEMORY_TASKS; i++) {
+        // A task that didn't exist yet doesn't count as having run out of stack
+        if (!memory_min.stack_free[i] || (sample.stack_free[i] && sample.stack_free[i] < memory_min.stack_free[i])) {
+            memory_min.stack_free[i] = sample.stack_free[i];
+        }
+    }
+    portEXIT_CRITICAL(&memory_lock);
+
+    if (out) {
+        *out = sample;
+    }
+}
+
+static void app_memory_tick(void *arg)
+{
+    app_memory_sample("periodic", nullptr);
+}
+
+esp_err_t app_memory_init()
+{
+    if (CONFIG_APP_MEMORY_SAMPLE_MS == 0 || memory_timer) {
+        return ESP_OK;
+    }
+
+    const esp_timer_create_args_t memory_timer_args = {
+        .callback = app_memory_tick,
+        .arg      = nullptr,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name     = "app_memory",
+        .skip_unhandled_events = true,
+    };
+    esp_err_t err = esp_timer_create(&memory_timer_args, &memory_timer);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create the memory sampler: %s", esp_err_to_name(err));
+        return err;
+    }
+    return esp_timer_start_periodic(memory_timer, CONFIG_APP_MEMORY_SAMPLE_MS * 1000ULL);
+}
+
+static void app_memory_print(FILE *out, const app_memory_sample_t &sample, const char *label)
+{
+    fprintf(out, "%-12s %10" PRId64 " %8" PRIu32 " %8" PRIu32 " %8" PRIu32, label, sample.time_us / 1000,
+            sample.free_heap, sample.min_free_heap, sample.largest_block);
+    for (int i = 0; i < APP_MEMORY_TASKS; i++) {
+        fprintf(out, " %12" PRIu32, sample.stack_free[i]);
+    }
+    fprintf(out, "\n");
+}
+
+void app_memory_dump(FILE *out)
+{
+    fprintf(out, "%-12s %10s %8s %8s %8s", "sample", "ms", "free", "min_free", "largest");
+    for (int i = 0; i < APP_MEMORY_TASKS; i++) {
+        fprintf(out, " %12s", memory_task_names[i]);
+    }
+    fprintf(out, "\n");
+
+    portENTER_CRITICAL(&memory_lock);
+    uint32_t head = memory_head;
+    app_memory_sample_t min = memory_min;
+    portEXIT_CRITICAL(&memory_lock);
+
+    uint32_t first = (head > CONFIG_APP_MEMORY_RING_LEN) ? head - CONFIG_APP_MEMORY_RING_LEN : 0;
+    for (uint32_t i = first; i < head; i++) {
+        portENTER_CRITICAL(&memory_lock);
+        app_memory_sample_t sample = memory_ring[i % CONFIG_APP_MEMORY_RING_LEN];
+        portEXIT_CRITICAL(&memory_lock);
+
+        app_memory_print(out, sample, sample.label);
+    }
+
+    if (head) {
+        app_memory_print(out, min, "minimum");
+    }
+}
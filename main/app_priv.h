@@ -1,6 +1,7 @@
 #ifndef APPPRIV_H
 #define APPPRIV_H
 
+#include <stdio.h>
 #include <esp_err.h>
 #include <esp_matter.h>
 #include <helpers.hpp>
@@ -11,14 +12,48 @@
 
 typedef void *app_driver_handle_t;
 
+/* What a fixture can show, decides the device type of its endpoint */
+typedef enum {
+    LIGHT_FIXTURE_COLOR, // RGB, optionally with white channels. Extended color light
+    LIGHT_FIXTURE_CCT,   // White + warm white only. Color temperature light
+} light_fixture_kind_t;
+
+/** Number of light fixtures wired to the board
+ *
+ * @return Number of fixtures, each one is initialized with `app_driver_light_init()`.
+ */
+size_t app_driver_light_fixture_count();
+
+/** Kind of a light fixture
+ *
+ * @param[in] fixture Index of the fixture, below `app_driver_light_fixture_count()`.
+ *
+ * @return Fixture kind.
+ */
+light_fixture_kind_t app_driver_light_fixture_kind(size_t fixture);
+
 /** Initialize the light driver
  *
- * This initializes the light driver associated with the selected board.
+ * This initializes the light driver of one fixture on the selected board, taking the next free LEDC channels and timer.
+ *
+ * @param[in] fixture Index of the fixture, below `app_driver_light_fixture_count()`.
  *
- * @return Handle on success.
+ * @return Handle on success, pass it as the endpoint's priv_data.
  * @return NULL in case of failure.
  */
-app_driver_handle_t app_driver_light_init();
+app_driver_handle_t app_driver_light_init(size_t fixture);
+
+/** Bind a light driver to its endpoint
+ *
+ * Commands and resyncs only carry the endpoint id, this makes the driver reachable from it.
+ *
+ * @param[in] endpoint_id Endpoint ID of the light.
+ * @param[in] driver_handle Handle returned by `app_driver_light_init()`.
+ *
+ * @return ESP_OK on success.
+ * @return error in case of failure.
+ */
+esp_err_t app_driver_light_bind(uint16_t endpoint_id, app_driver_handle_t driver_handle);
 
 /** Driver Update
  *
@@ -48,6 +83,141 @@ esp_err_t app_driver_attribute_update(app_driver_handle_t driver_handle, uint16_
 
 esp_err_t app_driver_light_set_defaults(uint16_t endpoint_id);
 
+/** Register command hooks for light driver
+ *
+ * Hooks the LevelControl/ColorControl move-to and stop commands so their transitions run on the LEDC fader.
+ * Must be called after the endpoint is created.
+ *
+ * @param[in] endpoint_id Endpoint ID of the driver.
+ *
+ * @return ESP_OK on success.
+ * @return error in case of failure.
+ */
+esp_err_t app_driver_light_register_commands(uint16_t endpoint_id);
+
+/** Drop every scene the light drivers cached
+ *
+ * For when the stack's scene tables change without a scene command, e.g. a fabric and its scenes are removed.
+ * Must be called from the CHIP thread, like the attribute and command callbacks.
+ */
+void app_driver_light_forget_scenes();
+
+/** Register the application shell commands
+ *
+ * Adds the light debugging commands (ledtrace, latency, boot, memory, attrrec) to the esp_matter console.
+ * Only used when CONFIG_ENABLE_CHIP_SHELL is set.
+ *
+ * @return ESP_OK on success.
+ * @return error in case of failure.
+ */
+esp_err_t app_console_register_commands();
+
+/* Boot phases, in the order they normally complete: X(name, label) */
+#define APP_BOOT_PHASES(X)                                                                         \
+    X(BOOT_PHASE_APP_MAIN,     "app_main")     /* Entered app_main */                              \
+    X(BOOT_PHASE_NVS,          "nvs")          /* nvs_flash_init done */                           \
+    X(BOOT_PHASE_DRIVERS,      "drivers")      /* LED drivers up, snapshot restored */             \
+    X(BOOT_PHASE_FIRST_LIGHT,  "first_light")  /* First non dark output, restored or reconciled */ \
+    X(BOOT_PHASE_NODE,         "node")         /* node::create done */                             \
+    X(BOOT_PHASE_ENDPOINTS,    "endpoints")    /* Light endpoints created and bound */             \
+    X(BOOT_PHASE_MATTER_START, "matter_start") /* esp_matter::start returned */                    \
+    X(BOOT_PHASE_RECONCILED,   "reconciled")   /* Output follows the data model */                 \
+    X(BOOT_PHASE_NETWORK,      "network")      /* First interface IP change */                     \
+    X(BOOT_PHASE_COMMISSIONED, "commissioned") /* Commissioning complete */
+
+typedef enum {
+#define APP_BOOT_PHASE_ENUM(name, label) name,
+    APP_BOOT_PHASES(APP_BOOT_PHASE_ENUM)
+#undef APP_BOOT_PHASE_ENUM
+    BOOT_PHASE_MAX,
+} app_boot_phase_t;
+
+/** Mark a boot phase as reached
+ *
+ * Records the esp_timer time (us since boot) the first time a phase is reached, later marks are ignored.
+ * Reaching BOOT_PHASE_NETWORK also logs the whole timeline as one `boot_timeline key=us ...` line.
+ *
+ * @param[in] phase Phase that just completed.
+ */
+void app_boot_mark(app_boot_phase_t phase);
+
+/** Print the boot timeline
+ *
+ * One line per phase with its timestamp and the time since the previous phase, phases not reached yet are skipped.
+ *
+ * @param[in] out Stream to print to.
+ */
+void app_boot_dump(FILE *out);
+
+/* Tasks whose stack high water mark is sampled, see app_memory.cpp */
+#define APP_MEMORY_TASKS 4
+
+typedef struct {
+    int64_t     time_us;
+    const char *label;         // Lifecycle point or "periodic", a string literal
+    uint32_t    free_heap;     // Bytes, 8 bit capable heap
+    uint32_t    min_free_heap; // Lowest free heap since boot, as tracked by the allocator
+    uint32_t    largest_block; // Largest free block, falls well below free_heap when the heap fragments
+    uint32_t    stack_free[APP_MEMORY_TASKS]; // Stack high water mark per task in bytes, 0 if the task doesn't exist
+} app_memory_sample_t;
+
+/** Start the periodic heap/stack sampler
+ *
+ * Samples every CONFIG_APP_MEMORY_SAMPLE_MS into a ring of CONFIG_APP_MEMORY_RING_LEN entries. With 0 nothing is
+ * started and only explicit samples are taken.
+ *
+ * @return ESP_OK on success.
+ * @return error in case of failure.
+ */
+esp_err_t app_memory_init();
+
+/** Take a heap/stack sample now
+ *
+ * Adds it to the ring and the running minimums. Safe from any task, a few hundred us as it walks the heap.
+ *
+ * @param[in] label Lifecycle point this sample is for, must outlive the ring (a string literal).
+ * @param[out] out Copy of the sample, may be NULL.
+ */
+void app_memory_sample(const char *label, app_memory_sample_t *out);
+
+/** Print the sample ring, oldest first, followed by the minimum of every value since boot
+ *
+ * @param[in] out Stream to print to.
+ */
+void app_memory_dump(FILE *out);
+
+/* One attribute update as it reached app_attribute_update_cb, for replay on the host (host/led_replay) */
+typedef struct {
+    uint32_t time_us;      // esp_timer time, low 32 bits
+    uint16_t endpoint_id;
+    uint8_t  val_type;     // esp_matter_val_type_t
+    uint8_t  reserved;
+    uint16_t cluster_id;   // Standard clusters and attributes fit 16 bits, others are not recorded
+    uint16_t attribute_id;
+    uint32_t value;        // b/u8/u16/u32 value, widened
+} app_record_t;
+
+/** Record an attribute update
+ *
+ * Adds it to a ring of CONFIG_APP_RECORD_LEN entries, the oldest are overwritten. Does nothing with a length of 0.
+ *
+ * @param[in] endpoint_id Endpoint ID of the attribute.
+ * @param[in] cluster_id Cluster ID of the attribute.
+ * @param[in] attribute_id Attribute ID of the attribute.
+ * @param[in] val New value.
+ */
+void app_record_attribute(uint16_t endpoint_id, uint32_t cluster_id, uint32_t attribute_id, const esp_matter_attr_val_t *val);
+
+/** Print the recorded updates, oldest first
+ *
+ * One `ATTRREC time endpoint cluster attribute type value` line of hex fields per update, the format host/led_replay
+ * reads. Console log prefixes in front of the marker are fine.
+ *
+ * @param[in] out Stream to print to.
+ */
+void app_record_dump(FILE *out);
+void app_record_clear();
+
 #if CHIP_DEVICE_CONFIG_ENABLE_THREAD
 #define ESP_OPENTHREAD_DEFAULT_RADIO_CONFIG()                                           \
     {                                                                                   \
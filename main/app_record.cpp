@@ -0,0 +1,81 @@
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <inttypes.h>
+#include <stdio.h>
+
+#include <app_priv.h>
+
+#if CONFIG_APP_RECORD_LEN > 0
+static app_record_t record_ring[CONFIG_APP_RECORD_LEN];
+static uint32_t     record_head = 0; // Updates recorded so far, the ring slot is head % len
+static portMUX_TYPE record_lock = portMUX_INITIALIZER_UNLOCKED; // CHIP task records, the console dumps
+#endif
+
+void app_record_attribute(uint16_t endpoint_id, uint32_t cluster_id, uint32_t attribute_id, const esp_matter_attr_val_t *val)
+{
+#if CONFIG_APP_RECORD_LEN > 0
+    if (cluster_id > UINT16_MAX || attribute_id > UINT16_MAX) {
+        return;
+    }
+
+    app_record_t record = {};
+    record.time_us      = (uint32_t)esp_timer_get_time();
+    record.endpoint_id  = endpoint_id;
+    record.val_type     = val->type;
+    record.cluster_id   = cluster_id;
+    record.attribute_id = attribute_id;
+
+    switch (val->type) {
+    case ESP_MATTER_VAL_TYPE_BOOLEAN:
+        record.value = val->val.b;
+        break;
+    case ESP_MATTER_VAL_TYPE_UINT8:
+    case ESP_MATTER_VAL_TYPE_ENUM8:
+    case ESP_MATTER_VAL_TYPE_BITMAP8:
+    case ESP_MATTER_VAL_TYPE_NULLABLE_UINT8:
+        record.value = val->val.u8;
+        break;
+    case ESP_MATTER_VAL_TYPE_UINT16:
+    case ESP_MATTER_VAL_TYPE_ENUM16:
+    case ESP_MATTER_VAL_TYPE_BITMAP16:
+    case ESP_MATTER_VAL_TYPE_NULLABLE_UINT16:
+        record.value = val->val.u16;
+        break;
+    default:
+        record.value = val->val.u32;
+        break;
+    }
+
+    portENTER_CRITICAL(&record_lock);
+    record_ring[record_head++ % CONFIG_APP_RECORD_LEN] = record;
+    portEXIT_CRITICAL(&record_lock);
+#endif
+}
+
+void app_record_dump(FILE *out)
+{
+#if CONFIG_APP_RECORD_LEN > 0
+    portENTER_CRITICAL(&record_lock);
+    uint32_t head = record_head;
+    portEXIT_CRITICAL(&record_lock);
+
+    uint32_t first = (head > CONFIG_APP_RECORD_LEN) ? head - CONFIG_APP_RECORD_LEN : 0;
+    for (uint32_t i = first; i < head; i++) {
+        portENTER_CRITICAL(&record_lock);
+        app_record_t record = record_ring[i % CONFIG_APP_RECORD_LEN];
+        portEXIT_CRITICAL(&record_lock);
+
+        fprintf(out, "ATTRREC %08" PRIx32 " %04x %04x %04x %02x %08" PRIx32 "\n", record.time_us, record.endpoint_id,
+                record.cluster_id, record.attribute_id, record.val_type, record.value);
+    }
+#endif
+}
+
+void app_record_clear()
+{
+#if CONFIG_APP_RECORD_LEN > 0
+    portENTER_CRITICAL(&record_lock);
+    record_head = 0;
+    portEXIT_CRITICAL(&record_lock);
+#endif
+}
@@ -0,0 +1,48 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Wait-free single producer / single consumer ring of fixed size entries.
+ * push() may only be called from one task and pop() from one (other) task, neither ever blocks */
+template<typename T, size_t LEN>
+class SPSC_Ring {
+    static_assert(LEN > 0 && (LEN & (LEN - 1)) == 0, "Ring length must be a power of two");
+
+    public:
+        bool push(const T &item) {
+            uint32_t h = head.load(std::memory_order_relaxed);
+            if (h - tail.load(std::memory_order_acquire) == LEN) {
+                return false; // Full
+            }
+
+            items[h & (LEN - 1)] = item;
+            head.store(h + 1, std::memory_order_release);
+            return true;
+        }
+
+        bool pop(T &item) {
+            uint32_t t = tail.load(std::memory_order_relaxed);
+            if (t == head.load(std::memory_order_acquire)) {
+                return false; // Empty
+            }
+
+            item = items[t & (LEN - 1)];
+            tail.store(t + 1, std::memory_order_release);
+            return true;
+        }
+
+        // Consumer side, whether pop() would return nothing
+        bool empty() const {
+            return tail.load(std::memory_order_relaxed) == head.load(std::memory_order_acquire);
+        }
+
+    private:
+        T items[LEN] = {};
+        std::atomic<uint32_t> head = {0}; // Only written by the producer
+        std::atomic<uint32_t> tail = {0}; // Only written by the consumer
+};
+
+#endif // SPSC_RING_H
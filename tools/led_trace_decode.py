@@ -0,0 +1,86 @@
+#!/usr/bin/env python3
+"""Decode the LED driver trace dump into readable text.
+
+Feed it the console output of `matter esp ledtrace dump` (a saved log or a pipe from the monitor).
+Event names and formats are read from the LED_TRACE_EVENTS table in led_trace.h, so the decoder
+always matches the firmware it was built from.
+
+    idf.py monitor | tee light.log
+    tools/led_trace_decode.py light.log
+"""
+
+import argparse
+import os
+import re
+import sys
+
+DEFAULT_HEADER = os.path.join(os.path.dirname(__file__), '..', 'components', 'led_driver', 'include', 'led_trace.h')
+
+EVENT_RE  = re.compile(r'X\(\s*(\w+)\s*,\s*(\d+)\s*,\s*(\d+)\s*,\s*"((?:[^"\\]|\\.)*)"\s*\)')
+RECORD_RE = re.compile(r'LEDTRACE ([0-9a-f]{8}) ([0-9a-f]{4}) ([0-9a-f]{4}) ([0-9a-f]{8}) ([0-9a-f]{8})')
+
+
+def load_events(header):
+    events = {}
+    with open(header) as f:
+        for name, event_id, level, fmt in EVENT_RE.findall(f.read()):
+            events[int(event_id)] = (name, fmt)
+    return events
+
+
+def to_signed(value):
+    # arg1/arg2 are 32 bit on the device, -1 (unchanged ColorXY half) comes out as 0xffffffff
+    return value - (1 << 32) if value & (1 << 31) else value
+
+
+def decode(lines, events, out):
+    first = None
+    last  = None
+    wraps = 0
+
+    for line in lines:
+        m = RECORD_RE.search(line)
+        if not m:
+            if 'LEDTRACE BEGIN' in line:
+                out.write(line[line.index('LEDTRACE'):].strip() + '\n')
+                first, last, wraps = None, None, 0
+            continue
+
+        timestamp, event_id, arg0, arg1, arg2 = (int(v, 16) for v in m.groups())
+
+        # The device keeps the low 32 bits of the us timer, unwrap so times stay monotonic
+        if last is not None and timestamp < last:
+            wraps += 1
+        last = timestamp
+        timestamp += wraps << 32
+        if first is None:
+            first = timestamp
+
+        name, fmt = events.get(event_id, ('UNKNOWN_%d' % event_id, '{0} {1} {2}'))
+        try:
+            text = fmt.format(arg0, to_signed(arg1), to_signed(arg2))
+        except (ValueError, IndexError):
+            text = '%s %d %d' % (fmt, arg1, arg2)
+
+        out.write('%12.3f ms  %-22s %s\n' % ((timestamp - first) / 1000.0, name, text))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('log', nargs='?', help='Console log with the dump, stdin if omitted')
+    parser.add_argument('--header', default=DEFAULT_HEADER, help='led_trace.h holding the event table')
+    args = parser.parse_args()
+
+    events = load_events(args.header)
+    if not events:
+        sys.exit('No trace events found in %s' % args.header)
+
+    if args.log:
+        with open(args.log, errors='replace') as f:
+            decode(f, events, sys.stdout)
+    else:
+        decode(sys.stdin, events, sys.stdout)
+
+
+if __name__ == '__main__':
+    main()